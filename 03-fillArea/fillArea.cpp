@@ -1,4 +1,5 @@
 #include <gccUtil/nowarnings.h>
+#include <algorithm>
 #include <climits>
 #include <cstdio>
 #include <iostream>
@@ -12,7 +13,10 @@
 #include <commonUtil/foreach.h>
 #include <gccUtil/restorewarnings.h>
 
+#include "../util/include/colorUtil.h"
 #include "../util/include/cvUtil.h"
+#include "../util/include/fillUtil.h"
+#include "../util/include/pnmUtil.h"
 #include "../util/include/strUtil.h"
 
 
@@ -25,6 +29,9 @@ typedef struct {
   bool        isXBase;
   int         trimBlank;
   int         foregroundColor;
+  double      tolerance;
+  ColorMetric metric;
+  size_t      memoryBudget;
   SizeInfo    sizeInfo;
 } Param;
 
@@ -35,23 +42,11 @@ parseArguments(int argc, char *argv[]);
 ATTR_NOTHROW ALWAYSINLINE static void
 showUsage(const char *progname) noexcept;
 
-ATTR_NOTHROW static cv::Mat
-fillAreaXBase(const cv::Mat &srcImage, int foregroundColor) noexcept;
+static size_t
+parseMemorySize(const char *sizeString);
 
-ATTR_NOTHROW static cv::Mat
-fillAreaYBase(const cv::Mat &srcImage, int foregroundColor) noexcept;
-
-ATTR_NOTHROW static cv::Rect
-searchArea(const cv::Mat &image, int foregroundColor) noexcept;
-
-ATTR_NOTHROW static cv::Rect
-addBlankToRect(const cv::Mat &image, const cv::Rect &roiRect, int blank) noexcept;
-
-
-static const int R_MASK   = 0x00ff0000;  //!< Mask for taking out the red from int value
-static const int G_MASK   = 0x0000ff00;  //!< Mask for taking out the green from int value
-static const int B_MASK   = 0x000000ff;  //!< Mask for taking out the blue from int value
-static const int RGB_MASK = 0x00ffffff;  //!< Mask for taking out the RGB from int value
+static bool
+fillAreaOutOfCore(const Param &param, const ColorMatcher &matcher, const std::string &dstFilename);
 
 
 /*!
@@ -71,45 +66,57 @@ main(int argc, char *argv[])
     showUsage(argv[0]);
     return EXIT_FAILURE;
   }
-  cv::Mat srcImage = cv::imread(param.srcFilename);
-  if (srcImage.data == nullptr) {
+  ColorMatcher matcher;
+  initColorMatcher(matcher, param.foregroundColor, param.tolerance, param.metric);
+
+  std::string dstFilename;
+  if (param.dstFilename == nullptr) {
+    dstFilename = removeSuffix(param.srcFilename) + "-filled." + getSuffix(param.srcFilename);
+  } else {
+    dstFilename = std::string(param.dstFilename);
+  }
+
+  if (param.memoryBudget != 0) {
+    return fillAreaOutOfCore(param, matcher, dstFilename) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  cv::Mat image = cv::imread(param.srcFilename);
+  if (image.data == nullptr) {
     return EXIT_FAILURE;
   }
 
-  cv::Mat dstImage;
+  // The image is filled in place.  Only when the source image has to be shown,
+  // the original contents of the rows which are overwritten are kept.
+  std::vector<cv::Mat> savedRows;
+  if (param.isShow) {
+    savedRows.resize(static_cast<std::vector<cv::Mat>::size_type>(image.rows));
+  }
   if (param.isXBase) {
-    dstImage = fillAreaXBase(srcImage, param.foregroundColor);
+    fillAreaXBase(image, matcher, param.isShow ? &savedRows : nullptr);
   } else {
-    dstImage = fillAreaYBase(srcImage, param.foregroundColor);
+    fillAreaYBase(image, matcher, param.isShow ? &savedRows : nullptr);
   }
 
+  cv::Mat dstImage = image;
   if (param.trimBlank != -1) {
-    cv::Rect roiRect = addBlankToRect(dstImage, searchArea(dstImage, param.foregroundColor), param.trimBlank);
-    dstImage = dstImage(cv::Rect(roiRect.x, roiRect.y, roiRect.width, roiRect.height));
+    cv::Rect roiRect = addBlankToRect(cv::Size(image.cols, image.rows), searchArea(image, matcher), param.trimBlank);
+    dstImage = image(cv::Rect(roiRect.x, roiRect.y, roiRect.width, roiRect.height));
+  }
+
+  // The result must be written before the original rows are restored for showing
+  if (param.isSave && !cv::imwrite(dstFilename, dstImage)) {
+    std::cerr << "Failed to write image: " << dstFilename << std::endl;
+    return EXIT_FAILURE;
   }
 
   if (param.isShow) {
     cv::namedWindow("srcImage", CV_WINDOW_AUTOSIZE);
     cv::namedWindow("dstImage", CV_WINDOW_AUTOSIZE);
-    cv::imshow("srcImage", resizeImage(srcImage, param.sizeInfo));
     cv::imshow("dstImage", resizeImage(dstImage, param.sizeInfo));
+    restoreRows(image, savedRows);
+    cv::imshow("srcImage", resizeImage(image, param.sizeInfo));
     cv::waitKey(0);
   }
-
-  if (!param.isSave) {
-    return EXIT_SUCCESS;
-  }
-
-  std::string dstFilename;
-  if (param.dstFilename == nullptr) {
-    dstFilename = removeSuffix(param.srcFilename) + "-filled." + getSuffix(param.srcFilename);
-  } else {
-    dstFilename = std::string(param.dstFilename);
-  }
-  if (!cv::imwrite(dstFilename, dstImage)) {
-    std::cerr << "Failed to write image: " << dstFilename << std::endl;
-    return EXIT_FAILURE;
-  }
   return EXIT_SUCCESS;
 }
 
@@ -126,20 +133,23 @@ static Param
 parseArguments(int argc, char *argv[])
 {
   static const struct option opts[] = {
-    {"nosave",     no_argument,       nullptr, 0},
-    {"noshow",     no_argument,       nullptr, 1},
-    {"direction",  required_argument, nullptr, 'd'},
-    {"foreground", required_argument, nullptr, 'f'},
-    {"help",       no_argument,       nullptr, 'h'},
-    {"output",     required_argument, nullptr, 'o'},
-    {"size",       required_argument, nullptr, 's'},
-    {"trim",       optional_argument, nullptr, 't'},
+    {"nosave",        no_argument,       nullptr, 0},
+    {"noshow",        no_argument,       nullptr, 1},
+    {"tolerance",     required_argument, nullptr, 2},
+    {"metric",        required_argument, nullptr, 3},
+    {"memory-budget", required_argument, nullptr, 4},
+    {"direction",     required_argument, nullptr, 'd'},
+    {"foreground",    required_argument, nullptr, 'f'},
+    {"help",          no_argument,       nullptr, 'h'},
+    {"output",        required_argument, nullptr, 'o'},
+    {"size",          required_argument, nullptr, 's'},
+    {"trim",          optional_argument, nullptr, 't'},
     {0, 0, 0, 0}   // must be filled with zero
   };
 
   int ret;
   int optidx;
-  Param param = {nullptr, nullptr, true, true, true, -1, 0x00000000, {-1, -1, 1.0, 1.0, 0.5}};
+  Param param = {nullptr, nullptr, true, true, true, -1, 0x00000000, 0.0, COLOR_METRIC_LINF, 0, {-1, -1, 1.0, 1.0, 0.5}};
   while ((ret = getopt_long(argc, argv, "d:f:ho:s:t:", opts, &optidx)) != -1) {
     switch (ret) {
       case 0:    // --nosave
@@ -148,6 +158,21 @@ parseArguments(int argc, char *argv[])
       case 1:    // --noshow
         param.isShow = false;
         break;
+      case 2:    // --tolerance
+        if (std::sscanf(optarg, "%lf", &param.tolerance) != 1) {
+          throw "Invalid option argument: --tolerance";
+        }
+        if (param.tolerance < 0.0) {
+          throw "Invalid value for option argument: --tolerance (negative value is not allowed)";
+        }
+        break;
+      case 3:    // --metric
+        param.metric = parseColorMetric(optarg);
+        break;
+      case 4:    // --memory-budget
+        param.memoryBudget = parseMemorySize(optarg);
+        param.isShow       = false;
+        break;
       case 'd':  // -d or --direction
         if (!std::strcmp(optarg, "x")) {
           param.isXBase = true;
@@ -190,6 +215,16 @@ parseArguments(int argc, char *argv[])
     throw "Invalid arguments";
   }
   param.srcFilename = argv[optind];
+  if (param.memoryBudget != 0) {
+    if (!param.isSave) {
+      throw "--memory-budget cannot be used with --nosave";
+    }
+    // fillAreaOutOfCore() writes binary PPM whatever the suffix of the output file is
+    std::string suffix = getSuffix(param.dstFilename == nullptr ? param.srcFilename : param.dstFilename);
+    if (suffix != "ppm" && suffix != "PPM") {
+      throw "--memory-budget requires the output file name to end with .ppm";
+    }
+  }
   return param;
 }
 
@@ -221,130 +256,166 @@ showUsage(const char *progname) noexcept
                "  -t (BLANK_SPACE), --trim(=BLANK_SPACE)\n"
                "    Specify blank-space for destination image\n"
                "    argument is optional\n"
+               "  --memory-budget=SIZE\n"
+               "    Fill binary PPM image band by band within specified memory size\n"
+               "    [NNN, NNNK, NNNM or NNNG]  (implies --noshow)\n"
+               "    --nosave cannot be used with this option\n"
+               "    The output file name must end with .ppm\n"
+               "  --metric=METRIC\n"
+               "    Specify metric of color distance for --tolerance [linf or deltae]\n"
+               "      DEFAULT_VALUE = linf\n"
                "  --nosave\n"
                "    Don't write result-image to file\n"
                "  --noshow\n"
-               "    Don't show result-image to window"
+               "    Don't show result-image to window\n"
+               "  --tolerance=DISTANCE\n"
+               "    Specify maximum color distance from object color\n"
+               "      DEFAULT_VALUE = 0 (exact match)"
             << std::endl;
 }
 
 
 /*!
- * @brief Fill area surrounded by specified color line with x-axis base
- * @param [in] srcImage         A image you want to fill
- * @param [in] foregroundColor  A color of line and area
- * @return  A fille image
+ * @brief Parse a string which specifies the size of memory
+ * @param [in] sizeString  A string such as "512", "64K", "256M" or "2G"
+ * @return  The size of memory in bytes
  */
-ATTR_NOTHROW static cv::Mat
-fillAreaXBase(const cv::Mat &srcImage, int foregroundColor) noexcept
+static size_t
+parseMemorySize(const char *sizeString)
 {
-  unsigned char foregroundR = static_cast<unsigned char>((foregroundColor & R_MASK) >> 16);
-  unsigned char foregroundG = static_cast<unsigned char>((foregroundColor & G_MASK) >> 8);
-  unsigned char foregroundB = static_cast<unsigned char>((foregroundColor & B_MASK));
-
-  cv::Mat dstImage = srcImage.clone();
-  REP_I (y, dstImage.rows) {
-    int x1 = 0;
-    while (x1 < dstImage.cols) {
-      for (; x1 < dstImage.cols && (*reinterpret_cast<int *>(&dstImage.data[y * dstImage.step + x1 * dstImage.elemSize()]) & RGB_MASK) != foregroundColor; x1++);
-      for (; x1 < dstImage.cols && (*reinterpret_cast<int *>(&dstImage.data[y * dstImage.step + x1 * dstImage.elemSize()]) & RGB_MASK) == foregroundColor; x1++);
-
-      int x2 = x1;
-      for (; x2 < dstImage.cols && (*reinterpret_cast<int *>(&dstImage.data[y * dstImage.step + x2 * dstImage.elemSize()]) & RGB_MASK) != foregroundColor; x2++);
-
-      if (x2 == dstImage.cols) continue;
-
-      for (int px = x1; px < x2; px++) {
-        unsigned char *restrict pixelAddr = &dstImage.data[y * dstImage.step + px * dstImage.elemSize()];
-        pixelAddr[0] = foregroundB;
-        pixelAddr[1] = foregroundG;
-        pixelAddr[2] = foregroundR;
-      }
-    }
+  double value;
+  char   unit = '\0';
+  if (std::sscanf(sizeString, "%lf%c", &value, &unit) < 1 || value < 1.0) {
+    throw "Invalid option argument: --memory-budget";
   }
-  return dstImage;
+  switch (unit) {
+    case '\0':
+      break;
+    case 'g':
+    case 'G':
+      value *= 1024.0;
+      // fall through
+    case 'm':
+    case 'M':
+      value *= 1024.0;
+      // fall through
+    case 'k':
+    case 'K':
+      value *= 1024.0;
+      break;
+    default:
+      throw "Invalid unit for option argument: --memory-budget";
+  }
+  return static_cast<size_t>(value);
 }
 
 
 /*!
- * @brief Fill area surrounded by specified color line with y-axis base
- * @param [in] srcImage         A image you want to fill
- * @param [in] foregroundColor  A color of line and area
- * @return  A fille image
+ * @brief Fill area of binary PPM image band by band within the memory budget
+ *
+ * The whole image is never loaded on the memory.  Filling a row (x-axis base)
+ * or a column (y-axis base) is equivalent to filling the range from the first
+ * to the last pixel of specified color in it.  So the x-axis base fill is done
+ * band by band independently, and for the y-axis base fill, only the first
+ * and the last positions of each column are kept between two passes.
+ * The bounding box of the filled region is also equal to the one of the
+ * pixels of specified color in the source image.
+ * @param [in] param        Parameter structure of this program
+ * @param [in] matcher      Classifier of the color of line and area
+ * @param [in] dstFilename  A name of destination binary PPM file
+ * @return  true if succeeded, otherwise false
  */
-ATTR_NOTHROW static cv::Mat
-fillAreaYBase(const cv::Mat &srcImage, int foregroundColor) noexcept
+static bool
+fillAreaOutOfCore(const Param &param, const ColorMatcher &matcher, const std::string &dstFilename)
 {
-  unsigned char foregroundR = static_cast<unsigned char>((foregroundColor & R_MASK) >> 16);
-  unsigned char foregroundG = static_cast<unsigned char>((foregroundColor & G_MASK) >> 8);
-  unsigned char foregroundB = static_cast<unsigned char>((foregroundColor & B_MASK));
-
-  cv::Mat dstImage = srcImage.clone();
-  REP_I (x, dstImage.cols) {
-    int y1 = 0;
-    while (y1 < dstImage.rows) {
-      for (; y1 < dstImage.rows && (*reinterpret_cast<int *>(&dstImage.data[y1 * dstImage.step + x * dstImage.elemSize()]) & RGB_MASK) != foregroundColor; y1++);
-      for (; y1 < dstImage.rows && (*reinterpret_cast<int *>(&dstImage.data[y1 * dstImage.step + x * dstImage.elemSize()]) & RGB_MASK) == foregroundColor; y1++);
-
-      int y2 = y1;
-      for (; y2 < dstImage.rows && (*reinterpret_cast<int *>(&dstImage.data[y2 * dstImage.step + x * dstImage.elemSize()]) & RGB_MASK) != foregroundColor; y2++);
-
-      if (y2 == dstImage.rows) continue;
+  PnmStream reader;
+  if (!openPnmReader(reader, param.srcFilename)) {
+    std::cerr << "Failed to read binary PPM file: " << param.srcFilename << std::endl;
+    return false;
+  }
 
-      for (int py = y1; py < y2; py++) {
-        unsigned char *restrict pixelAddr = &dstImage.data[py * dstImage.step + x * dstImage.elemSize()];
-        pixelAddr[0] = foregroundB;
-        pixelAddr[1] = foregroundG;
-        pixelAddr[2] = foregroundR;
+  // One row is reserved for the output buffer
+  size_t rowBytes   = static_cast<size_t>(reader.width) * 3;
+  size_t stateBytes = param.isXBase ? 0 : 2 * sizeof(int) * static_cast<size_t>(reader.width);
+  size_t bandRows   = param.memoryBudget > stateBytes + 2 * rowBytes ? (param.memoryBudget - stateBytes) / rowBytes - 1 : 1;
+  cv::Mat band(static_cast<int>(std::min(bandRows, static_cast<size_t>(reader.height))), reader.width, CV_8UC3);
+
+  // 1st pass: search the range of each column and the bounding box of the region
+  std::vector<int> firstRows;
+  std::vector<int> lastRows;
+  cv::Rect roiRect(0, 0, reader.width, reader.height);
+  if (!param.isXBase || param.trimBlank != -1) {
+    if (!param.isXBase) {
+      firstRows.assign(static_cast<size_t>(reader.width), -1);
+      lastRows.assign(static_cast<size_t>(reader.width), -1);
+    }
+    CvPoint p1 = {reader.width, reader.height};
+    CvPoint p2 = {0, 0};
+    for (int y0 = 0; y0 < reader.height; y0 += band.rows) {
+      cv::Mat rows = band.rowRange(0, std::min(band.rows, reader.height - y0));
+      if (!readPnmRows(reader, rows)) {
+        std::cerr << "Failed to read binary PPM file: " << param.srcFilename << std::endl;
+        closePnm(reader);
+        return false;
+      }
+      REP_I (i, rows.rows) {
+        const unsigned char *row = rows.ptr<unsigned char>(i);
+        REP_I (x, rows.cols) {
+          if (!isForegroundPixel(matcher, &row[3 * x])) continue;
+          int y = y0 + i;
+          if (!param.isXBase) {
+            if (firstRows[static_cast<size_t>(x)] == -1) firstRows[static_cast<size_t>(x)] = y;
+            lastRows[static_cast<size_t>(x)] = y;
+          }
+          if (p1.x > x) p1.x = x;
+          if (p1.y > y) p1.y = y;
+          if (p2.x < x) p2.x = x;
+          if (p2.y < y) p2.y = y;
+        }
       }
     }
-  }
-  return dstImage;
-}
-
-
-/*!
- * @brief Search the area of the filled region in image
- * @param [in] image            A filled image
- * @param [in] foregroundColor  A color of filled region
- * @return  Filled region in image
- */
-ATTR_NOTHROW static cv::Rect
-searchArea(const cv::Mat &image, int foregroundColor) noexcept
-{
-  CvPoint p1 = {image.cols, image.rows};
-  CvPoint p2 = {0, 0};
-  REP_I (i, image.rows) {
-    REP_I (j, image.cols) {
-      if ((*reinterpret_cast<int *>(&image.data[i * image.step + j * image.elemSize()]) & RGB_MASK) == foregroundColor) {
-        if (p1.x > j) p1.x = j;
-        if (p1.y > i) p1.y = i;
-        if (p2.x < j) p2.x = j;
-        if (p2.y < i) p2.y = i;
+    closePnm(reader);
+    if (param.trimBlank != -1) {
+      if (p1.x > p2.x) {
+        std::cerr << "No region is found in image: " << param.srcFilename << std::endl;
+        return false;
       }
+      roiRect = addBlankToRect(cv::Size(reader.width, reader.height), cv::Rect(p1.x, p1.y, p2.x - p1.x, p2.y - p1.y), param.trimBlank);
+    }
+    if (!openPnmReader(reader, param.srcFilename)) {
+      std::cerr << "Failed to read binary PPM file: " << param.srcFilename << std::endl;
+      return false;
     }
   }
-  cv::Rect areaRect(p1.x, p1.y, p2.x - p1.x, p2.y - p1.y);
-  return areaRect;
-}
-
-
-/*!
- * @brief Add blank to filled region
- * @param [in] image    A filled image
- * @param [in] roiRect  Filled region in image
- * @param [in] blank    blank width and height (pixel)
- * @return  Filled region with blank space
- */
-ATTR_NOTHROW static cv::Rect
-addBlankToRect(const cv::Mat &image, const cv::Rect &roiRect, int blank) noexcept
-{
-  if (blank < 1) return roiRect;
 
-  cv::Rect newRoiRect(roiRect.x - blank, roiRect.y - blank, roiRect.width + 2 * blank, roiRect.height + 2 * blank);
-  if (newRoiRect.x < 0) newRoiRect.x = 0;
-  if (newRoiRect.y < 0) newRoiRect.y = 0;
-  if (newRoiRect.x + newRoiRect.width  > image.cols)  newRoiRect.width  = image.cols - newRoiRect.x;
-  if (newRoiRect.y + newRoiRect.height > image.rows)  newRoiRect.height = image.rows - newRoiRect.y;
-  return newRoiRect;
+  // 2nd pass: fill each band and write the rows in the region
+  PnmStream writer;
+  if (!openPnmWriter(writer, dstFilename.c_str(), roiRect.width, roiRect.height)) {
+    std::cerr << "Failed to write image: " << dstFilename << std::endl;
+    closePnm(reader);
+    return false;
+  }
+  bool isSucceeded = true;
+  for (int y0 = 0; isSucceeded && y0 < roiRect.y + roiRect.height; y0 += band.rows) {
+    cv::Mat rows = band.rowRange(0, std::min(band.rows, roiRect.y + roiRect.height - y0));
+    if (!readPnmRows(reader, rows)) {
+      std::cerr << "Failed to read binary PPM file: " << param.srcFilename << std::endl;
+      isSucceeded = false;
+      break;
+    }
+    int begin = std::max(roiRect.y - y0, 0);
+    if (begin >= rows.rows) continue;
+    if (param.isXBase) {
+      fillAreaXBase(rows, matcher, nullptr);
+    } else {
+      fillColumnRanges(rows, matcher, y0, firstRows, lastRows);
+    }
+    if (!writePnmRows(writer, rows.rowRange(begin, rows.rows), roiRect.x, roiRect.width)) {
+      std::cerr << "Failed to write image: " << dstFilename << std::endl;
+      isSucceeded = false;
+    }
+  }
+  closePnm(reader);
+  closePnm(writer);
+  return isSucceeded;
 }
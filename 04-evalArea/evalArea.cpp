@@ -1,63 +1,450 @@
 /*!
  * @brief Calculate metrics of the image
  *
- * By one degree from zero to 360 degrees, calculates the distance to the
- * position where the boundary of the region from the center of gravity.
+ * By the specified step (default: one degree) from zero to 360 degrees,
+ * calculates the distance to the position where the boundary of the region
+ * from the center of gravity.
  *
  * @author  koturn 0;
  * @file    evalArea.cpp
  */
 #include <gccUtil/nowarnings.h>
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <getopt.h>
+#include <string>
+#include <utility>
 #include <vector>
 #include <opencv/cv.h>
 #include <opencv/cxcore.h>
 #include <opencv/highgui.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define USE_SSE2
+#endif
 #include <commonUtil/compat.h>
 #include <commonUtil/foreach.h>
 #include <gccUtil/restorewarnings.h>
 
+#include "../util/include/bitMaskUtil.h"
+#include "../util/include/cacheUtil.h"
+#include "../util/include/colorUtil.h"
 #include "../util/include/cvUtil.h"
+#include "../util/include/fileUtil.h"
+#include "../util/include/fillUtil.h"
+#include "../util/include/hashUtil.h"
+#include "../util/include/integralUtil.h"
 #include "../util/include/mathUtil.h"
+#include "../util/include/profileUtil.h"
+#include "../util/include/spanUtil.h"
 #include "../util/include/strUtil.h"
 
 
+//! Method to find the boundary of the region for each angle
+typedef enum {
+  EVAL_METHOD_RAY,      //!< Cast a ray for each angle
+  EVAL_METHOD_CONTOUR,  //!< Trace the boundary once and bin its pixels by angle
+  EVAL_METHOD_POLAR     //!< Warp the mask into polar coordinates and scan each row
+} EvalMethod;
+
+//! Pixel to choose among the boundary pixels in an angular bin
+typedef enum {
+  BIN_MODE_MAX,  //!< The farthest pixel from the center of gravity
+  BIN_MODE_MIN   //!< The nearest pixel to the center of gravity
+} BinMode;
+
+//! Method to calculate the moments of the region
+typedef enum {
+  MOMENT_METHOD_SPAN,    //!< Sum up the spans of the region
+  MOMENT_METHOD_CONTOUR  //!< Trace the outer boundary once and sum up its edges by Green's theorem
+} MomentMethod;
+
+//! Candidate center of the rays for --centers
+typedef enum {
+  CENTER_TYPE_CENTROID,   //!< Center of gravity
+  CENTER_TYPE_BBOX,       //!< Center of the bounding box
+  CENTER_TYPE_INSCRIBED,  //!< Center of the largest inscribed circle
+  N_CENTER_TYPES          //!< The number of the types
+} CenterType;
+
+static const char *const CENTER_TYPE_NAMES[] = {"centroid", "bbox", "inscribed"};  //!< Names of the types of center
+
+//! Direction to fill the area surrounded by the line before evaluation
+typedef enum {
+  FILL_MODE_NONE,  //!< Don't fill (the image is already filled)
+  FILL_MODE_X,     //!< Fill with x-axis base as fillArea -d x
+  FILL_MODE_Y      //!< Fill with y-axis base as fillArea -d y
+} FillMode;
+
+//! Format of the plot
+typedef enum {
+  PLOT_FORMAT_IMAGE,    //!< The whole image with the plotted points
+  PLOT_FORMAT_OVERLAY,  //!< Transparent image of the bounding box of the plotted points
+  PLOT_FORMAT_SVG       //!< Vector image of the plotted points
+} PlotFormat;
+
 //! The structre of parameters for this program
 typedef struct {
-  const char *srcFilename;      //!< A name of filled iamge
-  const char *plotFilename;     //!< A name of image which is plotted points
-  const char *dstFilename;      //!< A name of result csv-file
-  bool        isSave;           //!< Save combined image or not
-  bool        isShow;           //!< Show combined image or not
-  int         foregroundColor;  //!< A color of filled region
-  int         plotColor;        //!< A color for plotting
-  int         gPointColor;      //!< A color of gravity point
-  SizeInfo    sizeInfo;         //!< Size information of the iamge
+  const char  *srcFilename;       //!< A name of filled iamge
+  const char  *plotFilename;      //!< A name of image which is plotted points
+  const char  *dstFilename;       //!< A name of result csv-file
+  const char  *profileFilename;   //!< A name of binary profile file to append the result
+  const char  *batchFilename;     //!< A name of manifest file or directory of images to evaluate
+  const char  *filledFilename;    //!< A name of image to write the filled and trimmed image
+  const char  *cacheDirname;      //!< A name of directory of the result cache
+  const char  *roiFilename;       //!< A name of file of the rectangles to evaluate the area and the centroid
+  const char  *sequenceFilename;  //!< A name of manifest file or directory of frames to evaluate in order
+  bool         isSave;            //!< Save combined image or not
+  bool         isShow;            //!< Show combined image or not
+  bool         isBenchmark;       //!< Measure the processing time instead of evaluation
+  bool         isSubpixel;        //!< Refine the boundary to sub-pixel or not
+  bool         isRegions;         //!< Evaluate each connected component separately or not
+  int          foregroundColor;   //!< A color of filled region
+  double       tolerance;         //!< Maximum color distance from the foreground color
+  ColorMetric  metric;            //!< Metric of the color distance
+  int          plotColor;         //!< A color for plotting
+  int          gPointColor;       //!< A color of gravity point
+  double       degreeStep;        //!< Angular step of the rays in degree
+  double       maxDrift;          //!< Maximum drift of the centroid to keep the origin of the rays in sequence mode
+  double       adaptiveThreshold; //!< Difference of the neighboring distances to bisect the angles (0 means the uniform step)
+  EvalMethod   method;            //!< Method to find the boundary of the region
+  MomentMethod momentMethod;      //!< Method to calculate the moments of the region
+  BinMode      binMode;           //!< Pixel to choose in an angular bin of contour method
+  FillMode     fillMode;          //!< Direction to fill the image before evaluation
+  PlotFormat   plotFormat;        //!< Format of the plot
+  int          trimBlank;         //!< Blank space around the trimmed region (-1 means no trimming)
+  int          nFourier;          //!< The number of Fourier coefficients of the profile (0 means none)
+  int          minArea;           //!< Minimum area of the components to evaluate
+  int          cacheSize;         //!< Maximum size of the result cache in MiB
+  int          centerFlags;       //!< Bit flags of CenterType to evaluate the profiles from (0 means only the centroid)
+  SizeInfo     sizeInfo;          //!< Size information of the iamge
 } Param;
 
+static const int    CACHE_LINE_SIZE      = 64;   //!< Size of a cache line in bytes
+static const double ADAPTIVE_COARSE_STEP = 8.0;  //!< Maximum angular step of the first rays of the adaptive sampling in degree
+
+//! Partial sums for moment of each thread, which is padded to the size of a cache line
+typedef struct {
+  long long cnt;    //!< The number of pixels
+  long long sumX;   //!< Sum of x-positions
+  long long sumY;   //!< Sum of y-positions
+  double    sumXX;  //!< Sum of squared x-positions
+  double    sumXY;  //!< Sum of products of x-positions and y-positions
+  double    sumYY;  //!< Sum of squared y-positions
+  char      padding[CACHE_LINE_SIZE - 3 * sizeof(long long) - 3 * sizeof(double)];
+} MomentSums;
+
+//! Sums of the edges of the boundary polygon for moment by Green's theorem
+typedef struct {
+  long long s00;  //!< Sum of (x0 * y1 - x1 * y0), which is twice the signed area
+  long long s10;  //!< Sum for the first order moment of x
+  long long s01;  //!< Sum for the first order moment of y
+  long long s20;  //!< Sum for the second order moment of x
+  long long s11;  //!< Sum for the second order moment of x and y
+  long long s02;  //!< Sum for the second order moment of y
+} EdgeSums;
+
+//! Raw moments of the region up to second order
+typedef struct {
+  double m00;  //!< Area
+  double m10;  //!< Sum of x-positions
+  double m01;  //!< Sum of y-positions
+  double m20;  //!< Sum of squared x-positions
+  double m11;  //!< Sum of products of x-positions and y-positions
+  double m02;  //!< Sum of squared y-positions
+} Moments;
+
+//! Shape features which are derived from moments
+typedef struct {
+  double centroidX;     //!< X-position of the center of gravity
+  double centroidY;     //!< Y-position of the center of gravity
+  double majorAxis;     //!< Semi-major axis of the ellipse which has the same second moments
+  double minorAxis;     //!< Semi-minor axis of the ellipse which has the same second moments
+  double orientation;   //!< Angle between x-axis and major axis (degree, clockwise in image)
+  double eccentricity;  //!< Eccentricity of the ellipse which has the same second moments
+} ShapeFeatures;
+
+//! Points in the boundary of the region for each angle, which are stored as structure of arrays
+struct CrossPoints {
+  std::vector<double> xs;  //!< X-positions of the points
+  std::vector<double> ys;  //!< Y-positions of the points
+
+  CrossPoints() :
+    xs(),
+    ys()
+  {}
+};
+
+//! Summary of the distances from the center of gravity to the boundary
+typedef struct {
+  double minRadius;    //!< Minimum distance
+  double maxRadius;    //!< Maximum distance
+  double meanRadius;   //!< Mean of the distances
+  double stdRadius;    //!< Standard deviation of the distances
+  double radiusRatio;  //!< Ratio of the minimum distance to the maximum distance
+  double circularity;  //!< 4 * pi * area / perimeter^2 of the polygon of the boundary points
+} RadiusSummary;
+
+//! A named rectangle to evaluate the area and the centroid
+struct Roi {
+  std::string name;  //!< Name of the rectangle
+  cv::Rect    rect;  //!< The rectangle
+
+  Roi() :
+    name(),
+    rect()
+  {}
+};
+
+//! Results of the evaluation of a region
+struct RegionResult {
+  Moments             moments;      //!< Moments of the region
+  ShapeFeatures       features;     //!< Shape features of the region
+  CrossPoints         crossPoints;  //!< Points in the boundary of the region for each angle
+  std::vector<double> angles;       //!< The angles of the points, which are empty for the uniform step
+  std::vector<double> distances;    //!< The distances to the boundary for each angle
+  RadiusSummary       summary;      //!< Summary of the distances
+  std::vector<double> descriptor;   //!< Fourier descriptor of the distances
+
+  RegionResult() :
+    moments(),
+    features(),
+    crossPoints(),
+    angles(),
+    distances(),
+    summary(),
+    descriptor()
+  {}
+};
+
+//! Profile of the region from a candidate center
+struct CenterProfile {
+  CenterType   type;    //!< Type of the center
+  cv::Point2d  center;  //!< The center, which is the origin of the rays
+  RegionResult result;  //!< Result of the region whose profile is from the center
+
+  CenterProfile() :
+    type(CENTER_TYPE_CENTROID),
+    center(),
+    result()
+  {}
+};
+
+//! State of the evaluation of the frames which is carried to the next frame
+struct SequenceState {
+  BitMask     mask;         //!< Mask of the region of the previous frame
+  Moments     moments;      //!< Moments of the region of the previous frame
+  cv::Point2d origin;       //!< Origin of the rays
+  CrossPoints crossPoints;  //!< Points in the boundary for each angle from the origin
+  bool        isValid;      //!< The previous frame is evaluated or not
+
+  SequenceState() :
+    mask(),
+    moments(),
+    origin(),
+    crossPoints(),
+    isValid(false)
+  {}
+};
+
+//! Statistics of the incremental evaluation of the frames
+typedef struct {
+  int       nFullFrames;     //!< The number of the frames which are evaluated from scratch
+  long long nChangedPixels;  //!< The number of the pixels which are changed from the previous frame
+  long long nCastRays;       //!< The number of the rays which are cast
+  long long nRays;           //!< The number of the rays of all frames
+} SequenceStats;
+
 static Param
 parseArguments(int argc, char *argv[]);
 
 ATTR_NOTHROW ALWAYSINLINE static void
 showUsage(const char *progname) noexcept;
 
-ATTR_PURE ATTR_NOTHROW CONSTEXPR_CXX14 static CvPoint
-calcMoment(const cv::Mat &image, int foregroundColor) noexcept;
+static EvalMethod
+parseEvalMethod(const char *methodString);
+
+static BinMode
+parseBinMode(const char *modeString);
+
+static FillMode
+parseFillMode(const char *modeString);
 
-ATTR_NOTHROW static std::vector<CvPoint>
-evalArea(const cv::Mat &image, const CvPoint &cp, int foregroundColor) noexcept;
+static PlotFormat
+parsePlotFormat(const char *formatString);
+
+static MomentMethod
+parseMomentMethod(const char *methodString);
+
+static int
+parseCenterFlags(const char *listString);
 
 ATTR_NOTHROW static cv::Mat
-plotCrossPoints(const cv::Mat &image, const std::vector<CvPoint> &crossPoints, int plotColor) noexcept;
+fillImage(cv::Mat &image, const ColorMatcher &matcher, FillMode fillMode, int trimBlank) noexcept;
+
+ATTR_NOTHROW static Moments
+calcMoment(const SpanIndex &index) noexcept;
+
+ATTR_NOTHROW static Moments
+calcMomentByContour(const SpanIndex &index) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static void
+addEdgeSums(EdgeSums &sums, long long x0, long long y0, long long x1, long long y1) noexcept;
+
+ATTR_NOTHROW static ShapeFeatures
+calcShapeFeatures(const Moments &moments) noexcept;
+
+static CrossPoints
+calcProfile(const SpanIndex &index, const cv::Point2d &gp, double degreeStep, EvalMethod method, BinMode binMode, bool isSubpixel);
+
+ATTR_NOTHROW static CrossPoints
+evalArea(const SpanIndex &index, const SpanIndex &columns, const cv::Point2d &gp, double degreeStep, bool isSubpixel) noexcept;
+
+ATTR_NOTHROW static CrossPoints
+evalAreaAdaptive(const SpanIndex &index, const SpanIndex &columns, const cv::Point2d &gp, double degreeStep, double threshold, bool isSubpixel, std::vector<double> &angles) noexcept;
+
+static std::vector<double>
+resampleProfile(const std::vector<double> &angles, const std::vector<double> &distances, double degreeStep);
+
+ATTR_NOTHROW static cv::Point2d
+castRay(const SpanIndex &index, const SpanIndex &columns, const cv::Point2d &gp, double theta, bool isSubpixel) noexcept;
+
+ATTR_NOTHROW static bool
+findRayExit(const SpanIndex &lines, int major0, int step, long long minorFixed, long long slope, int &major, int &minor, bool &isInside) noexcept;
+
+ATTR_NOTHROW static cv::Point2d
+refineCrossPoint(const SpanIndex &index, const cv::Point2d &inside, const cv::Point2d &outside) noexcept;
+
+ATTR_NOTHROW static double
+sampleCoverage(const SpanIndex &index, const cv::Point2d &p) noexcept;
+
+static CrossPoints
+evalAreaByContour(const SpanIndex &index, const cv::Point2d &gp, double degreeStep, BinMode binMode);
+
+static CrossPoints
+evalAreaByPolar(const SpanIndex &index, const cv::Point2d &gp, double degreeStep, bool isSubpixel);
+
+ATTR_PURE ATTR_NOTHROW static int
+countRays(double degreeStep) noexcept;
+
+ATTR_NOTHROW static void
+plotCrossPoints(cv::Mat &image, const CrossPoints &crossPoints, int plotColor, const cv::Point &origin) noexcept;
+
+ATTR_NOTHROW static void
+plotRegions(cv::Mat &image, const std::vector<RegionResult> &results, const Param &param, const cv::Point &origin) noexcept;
+
+ATTR_NOTHROW static cv::Rect
+calcPlotRect(const std::vector<RegionResult> &results, const cv::Mat &image) noexcept;
+
+static bool
+writePlotSvg(const std::string &filename, const std::vector<RegionResult> &results, const cv::Mat &image, const Param &param);
+
+static std::string
+makePlotFilename(const Param &param);
+
+ATTR_NOTHROW static cv::Scalar
+toPlotScalar(int color) noexcept;
 
 ATTR_NOTHROW static std::vector<double>
-calcResults(const CvPoint &gp, const std::vector<CvPoint> &crossPoints) noexcept;
+calcResults(const cv::Point2d &gp, const CrossPoints &crossPoints, RadiusSummary &summary) noexcept;
+
+ATTR_NOTHROW static void
+calcRadiusStats(const std::vector<double> &distances, RadiusSummary &summary) noexcept;
+
+static void
+printSummary(const RadiusSummary &summary);
+
+static std::vector<double>
+calcFourierDescriptor(const std::vector<double> &distances, int nCoefficients);
+
+static void
+evalRegions(const SpanIndex &index, const Param &param, std::vector<RegionResult> &results);
+
+static void
+evalRegion(const SpanIndex &index, const Param &param, RegionResult &result);
+
+static void
+evalCenters(const SpanIndex &index, const RegionResult &region, const Param &param, std::vector<CenterProfile> &profiles);
+
+static cv::Point2d
+findCenter(const SpanIndex &index, const ShapeFeatures &features, CenterType type);
+
+static std::string
+makeCenterName(const char *name, const char *centerName);
 
-static const int R_MASK   = 0x00ff0000;  //!< Mask for taking out the red from int value
-static const int G_MASK   = 0x0000ff00;  //!< Mask for taking out the green from int value
-static const int B_MASK   = 0x000000ff;  //!< Mask for taking out the blue from int value
+static bool
+writeCenterProfiles(ProfileWriter &writer, const char *name, const std::vector<CenterProfile> &profiles, const Param &param);
+
+static void
+writeCenterCsv(std::FILE *fp, const char *name, const std::vector<CenterProfile> &profiles, const Param &param);
+
+static void
+printRegion(const RegionResult &result);
+
+static std::string
+makeRegionName(const char *name, size_t regionIndex, bool isRegions);
+
+static bool
+writeRegionProfiles(ProfileWriter &writer, const char *name, const std::vector<RegionResult> &results, const Param &param);
+
+static void
+writeRegionCsv(std::FILE *fp, const char *name, const std::vector<RegionResult> &results, const Param &param, bool isShowName);
+
+static std::vector<double>
+makeFeatureScalars(const RegionResult &result);
+
+static bool
+writeProfile(ProfileWriter &writer, const char *name, const RegionResult &result, double degreeStep);
+
+static unsigned long long
+calcCacheSeed(const Param &param);
+
+static void
+serializeRegions(const std::vector<RegionResult> &results, std::vector<unsigned char> &data);
+
+static bool
+deserializeRegions(const std::vector<unsigned char> &data, std::vector<RegionResult> &results);
+
+static int
+evalBatch(const Param &param, const ColorMatcher &matcher);
+
+static bool
+listImageFiles(const char *listname, std::vector<std::string> &filenames);
+
+static int
+evalSequence(const Param &param, const ColorMatcher &matcher);
+
+static void
+evalFrame(const SpanIndex &index, const Param &param, SequenceState &state, RegionResult &result, SequenceStats &stats);
+
+ATTR_NOTHROW static long long
+updateMoments(Moments &moments, const std::vector<MaskRun> &runs, double sign) noexcept;
+
+ATTR_NOTHROW static void
+markDirtyRays(const std::vector<MaskRun> &runs, const cv::Point2d &origin, const CrossPoints &crossPoints, double degreeStep, std::vector<unsigned char> &isDirty) noexcept;
+
+static bool
+readRoiFile(const char *filename, std::vector<Roi> &rois);
+
+static void
+evalRois(const SpanIndex &index, const std::vector<Roi> &rois, std::FILE *fp);
+
+static void
+benchmark(const cv::Mat &image, const ColorMatcher &matcher, double degreeStep);
+
+static void
+compareMethods(const SpanIndex &index, const cv::Point2d &gp);
+
+static void
+compareMoments(const SpanIndex &index);
+
+static void
+compareCenters(const SpanIndex &index, const ShapeFeatures &features);
 
 
 /*!
@@ -77,42 +464,117 @@ main(int argc, char *argv[])
     showUsage(argv[0]);
     return EXIT_FAILURE;
   }
-  cv::Mat image = cv::imread(param.srcFilename);
-  if (image.data == nullptr) {
+  ColorMatcher matcher;
+  initColorMatcher(matcher, param.foregroundColor, param.tolerance, param.metric);
+  if (param.batchFilename != nullptr) {
+    return evalBatch(param, matcher);
+  }
+  if (param.sequenceFilename != nullptr) {
+    return evalSequence(param, matcher);
+  }
+  std::vector<Roi> rois;
+  if (param.roiFilename != nullptr && !readRoiFile(param.roiFilename, rois)) {
+    std::cerr << "Failed to read roi-file: " << param.roiFilename << std::endl;
+    return EXIT_FAILURE;
+  }
+  cv::Mat srcImage = cv::imread(param.srcFilename);
+  if (srcImage.data == nullptr) {
     std::cerr << "Failed to read image file: " << param.srcFilename << std::endl;
     return EXIT_FAILURE;
   }
+  cv::Mat image = fillImage(srcImage, matcher, param.fillMode, param.trimBlank);
+  if (param.filledFilename != nullptr && !cv::imwrite(param.filledFilename, image)) {
+    std::cerr << "Failed to write image: " << param.filledFilename << std::endl;
+    return EXIT_FAILURE;
+  }
 
   std::printf("foregroundColor = 0x%08x\n", param.foregroundColor);
-  CvPoint gp = calcMoment(image, param.foregroundColor);
-  std::printf("moment = (%d, %d)\n", gp.x, gp.y);
-
-  std::vector<CvPoint> crossPoints = evalArea(image, gp, param.foregroundColor);
-  // FOREACH (cp, crossPoints) {
-  //   std::printf("(x, y) = (%d, %d)\n", cp->x, cp->y);
-  // }
-  // std::printf("%u points was plotted\n", crossPoints.size());
+  if (param.isBenchmark) {
+    benchmark(image, matcher, param.degreeStep);
+    SpanIndex index;
+    buildSpanIndex(index, image, matcher);
+    ShapeFeatures features = calcShapeFeatures(calcMoment(index));
+    compareMethods(index, cv::Point2d(features.centroidX, features.centroidY));
+    compareMoments(index);
+    compareCenters(index, features);
+    return EXIT_SUCCESS;
+  }
+  SpanIndex index;
+  buildSpanIndex(index, image, matcher);
+  if (param.roiFilename != nullptr) {
+    std::FILE *fp = param.dstFilename == nullptr ? stdout : std::fopen(param.dstFilename, "w");
+    if (fp == nullptr) {
+      std::cerr << "Failed to open file: " << param.dstFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+    evalRois(index, rois, fp);
+    if (fp != stdout) {
+      std::fclose(fp);
+    }
+    return EXIT_SUCCESS;
+  }
+  std::vector<RegionResult> results;
+  evalRegions(index, param, results);
+  if (param.isRegions) {
+    std::printf("regions = %lu\n", static_cast<unsigned long>(results.size()));
+  }
+  REP (i, results.size()) {
+    if (param.isRegions) {
+      std::printf("region = %lu\n", static_cast<unsigned long>(i));
+    }
+    printRegion(results[i]);
+  }
+  std::vector<CenterProfile> centers;
+  if (!param.isRegions && param.centerFlags != 0) {
+    evalCenters(index, results[0], param, centers);
+    REP (i, centers.size()) {
+      std::printf("center = %s (%f, %f)\n", CENTER_TYPE_NAMES[centers[i].type], centers[i].center.x, centers[i].center.y);
+      printSummary(centers[i].result.summary);
+    }
+  }
+  cv::Rect plotRect;
+  if (param.isSave && param.plotFormat == PLOT_FORMAT_OVERLAY) {
+    plotRect = calcPlotRect(results, image);
+    std::printf("overlay = (%d, %d, %d, %d)\n", plotRect.x, plotRect.y, plotRect.width, plotRect.height);
+  }
 
-  std::vector<double> scores = calcResults(gp, crossPoints);
-  if (param.dstFilename == nullptr) {
-    REP (i, scores.size()) {
-      std::printf("%03d,%f\n", i, scores[i]);
+  if (param.profileFilename != nullptr) {
+    ProfileWriter writer;
+    if (!openProfileWriter(writer, param.profileFilename)
+        || !(centers.empty()
+          ? writeRegionProfiles(writer, param.srcFilename, results, param)
+          : writeCenterProfiles(writer, param.srcFilename, centers, param))) {
+      closeProfileWriter(writer);
+      std::cerr << "Failed to write profile file: " << param.profileFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+    closeProfileWriter(writer);
+  } else if (param.dstFilename == nullptr) {
+    if (centers.empty()) {
+      writeRegionCsv(stdout, param.srcFilename, results, param, param.isRegions);
+    } else {
+      writeCenterCsv(stdout, param.srcFilename, centers, param);
     }
   } else {
     std::FILE *fp = std::fopen(param.dstFilename, "w");
-    REP (i, scores.size()) {
-      std::fprintf(fp, "%03d,%f\n", i, scores[i]);
+    if (fp == nullptr) {
+      std::cerr << "Failed to open file: " << param.dstFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (centers.empty()) {
+      writeRegionCsv(fp, param.srcFilename, results, param, param.isRegions);
+    } else {
+      writeCenterCsv(fp, param.srcFilename, centers, param);
     }
     std::fclose(fp);
   }
 
-  cv::Mat plottedImage = plotCrossPoints(image, crossPoints, param.plotColor);
-  cv::Scalar color(
-      (param.gPointColor & B_MASK),
-      (param.gPointColor & G_MASK) >> 8,
-      (param.gPointColor & R_MASK) >> 16
-  );
-  cv::circle(plottedImage, cv::Point(gp.x, gp.y), 1, color, -1, CV_AA);
+  // The copy of the whole image is made only if it is shown or saved
+  cv::Mat plottedImage;
+  if (param.isShow || (param.isSave && param.plotFormat == PLOT_FORMAT_IMAGE)) {
+    plottedImage = image.clone();
+    plotRegions(plottedImage, results, param, cv::Point(0, 0));
+  }
   if (param.isShow) {
     cv::namedWindow("srcImage", CV_WINDOW_AUTOSIZE);
     cv::namedWindow("dstImage", CV_WINDOW_AUTOSIZE);
@@ -125,11 +587,20 @@ main(int argc, char *argv[])
     return EXIT_SUCCESS;
   }
 
-  std::string plotFilename;
-  if (param.plotFilename == nullptr) {
-    plotFilename = removeSuffix(param.srcFilename) + "-plotted." + getSuffix(param.srcFilename);
-  } else {
-    plotFilename = std::string(param.plotFilename);
+  std::string plotFilename = makePlotFilename(param);
+  switch (param.plotFormat) {
+    case PLOT_FORMAT_OVERLAY:
+      plottedImage = cv::Mat(plotRect.height, plotRect.width, CV_8UC4, cv::Scalar(0, 0, 0, 0));
+      plotRegions(plottedImage, results, param, cv::Point(plotRect.x, plotRect.y));
+      break;
+    case PLOT_FORMAT_SVG:
+      if (!writePlotSvg(plotFilename, results, image, param)) {
+        std::cerr << "Failed to write svg-file: " << plotFilename << std::endl;
+        return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+    case PLOT_FORMAT_IMAGE:
+      break;
   }
   if (!cv::imwrite(plotFilename, plottedImage)) {
     std::cerr << "Failed to write image: " << plotFilename << std::endl;
@@ -151,29 +622,77 @@ static Param
 parseArguments(int argc, char *argv[])
 {
   static const struct option opts[] = {
-    {"nosave",     no_argument,       nullptr, 0},
-    {"noshow",     no_argument,       nullptr, 1},
-    {"color",      required_argument, nullptr, 'c'},
-    {"foreground", required_argument, nullptr, 'f'},
-    {"gcolor",     required_argument, nullptr, 'g'},
-    {"help",       no_argument,       nullptr, 'h'},
-    {"output",     required_argument, nullptr, 'o'},
-    {"plot-file",  required_argument, nullptr, 'p'},
-    {"size",       required_argument, nullptr, 's'},
+    {"nosave",       no_argument,       nullptr, 0},
+    {"noshow",       no_argument,       nullptr, 1},
+    {"tolerance",    required_argument, nullptr, 2},
+    {"metric",       required_argument, nullptr, 3},
+    {"benchmark",    no_argument,       nullptr, 4},
+    {"step",         required_argument, nullptr, 5},
+    {"method",       required_argument, nullptr, 6},
+    {"bin-mode",     required_argument, nullptr, 7},
+    {"subpixel",     no_argument,       nullptr, 8},
+    {"profile-file", required_argument, nullptr, 9},
+    {"batch",        required_argument, nullptr, 10},
+    {"fill",         required_argument, nullptr, 11},
+    {"trim",         optional_argument, nullptr, 12},
+    {"filled-file",  required_argument, nullptr, 13},
+    {"fourier",      required_argument, nullptr, 14},
+    {"regions",      no_argument,       nullptr, 15},
+    {"min-area",     required_argument, nullptr, 16},
+    {"cache",        required_argument, nullptr, 17},
+    {"cache-size",   required_argument, nullptr, 18},
+    {"plot-format",  required_argument, nullptr, 19},
+    {"roi-file",     required_argument, nullptr, 20},
+    {"moment",       required_argument, nullptr, 21},
+    {"sequence",     required_argument, nullptr, 22},
+    {"max-drift",    required_argument, nullptr, 23},
+    {"centers",      required_argument, nullptr, 24},
+    {"adaptive",     required_argument, nullptr, 25},
+    {"color",        required_argument, nullptr, 'c'},
+    {"foreground",   required_argument, nullptr, 'f'},
+    {"gcolor",       required_argument, nullptr, 'g'},
+    {"help",         no_argument,       nullptr, 'h'},
+    {"output",       required_argument, nullptr, 'o'},
+    {"plot-file",    required_argument, nullptr, 'p'},
+    {"size",         required_argument, nullptr, 's'},
     {0, 0, 0, 0}   // must be filled with zero
   };
 
   int ret;
   int optidx;
   Param param = {
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
     nullptr,
     nullptr,
     nullptr,
     true,
     true,
+    false,
+    false,
+    false,
     0x00000000,
+    0.0,
+    COLOR_METRIC_LINF,
     0x00ff0000,
     0x0000ff00,
+    1.0,
+    1.0,
+    0.0,
+    EVAL_METHOD_RAY,
+    MOMENT_METHOD_SPAN,
+    BIN_MODE_MAX,
+    FILL_MODE_NONE,
+    PLOT_FORMAT_IMAGE,
+    -1,
+    0,
+    1,
+    256,
+    0,
     {-1, -1, 1.0, 1.0, 0.5}
   };
   while ((ret = getopt_long(argc, argv, "f:g:ho:s:", opts, &optidx)) != -1) {
@@ -184,6 +703,120 @@ parseArguments(int argc, char *argv[])
       case 1:    // --noshow
         param.isShow = false;
         break;
+      case 2:    // --tolerance
+        if (std::sscanf(optarg, "%lf", &param.tolerance) != 1) {
+          throw "Invalid option argument: --tolerance";
+        }
+        if (param.tolerance < 0.0) {
+          throw "Invalid value for option argument: --tolerance (negative value is not allowed)";
+        }
+        break;
+      case 3:    // --metric
+        param.metric = parseColorMetric(optarg);
+        break;
+      case 4:    // --benchmark
+        param.isBenchmark = true;
+        break;
+      case 5:    // --step
+        if (std::sscanf(optarg, "%lf", &param.degreeStep) != 1) {
+          throw "Invalid option argument: --step";
+        }
+        if (param.degreeStep <= 0.0 || 360.0 < param.degreeStep) {
+          throw "Invalid value for option argument: --step (must be in (0, 360])";
+        }
+        break;
+      case 6:    // --method
+        param.method = parseEvalMethod(optarg);
+        break;
+      case 7:    // --bin-mode
+        param.binMode = parseBinMode(optarg);
+        break;
+      case 8:    // --subpixel
+        param.isSubpixel = true;
+        break;
+      case 9:    // --profile-file
+        param.profileFilename = optarg;
+        break;
+      case 10:   // --batch
+        param.batchFilename = optarg;
+        break;
+      case 11:   // --fill
+        param.fillMode = parseFillMode(optarg);
+        break;
+      case 12:   // --trim
+        if (optarg == nullptr) {
+          param.trimBlank = 0;
+        } else if (std::sscanf(optarg, "%d", &param.trimBlank) != 1) {
+          throw "Invalid option argument: --trim";
+        }
+        if (param.trimBlank < 0) {
+          throw "Invalid value for option argument: --trim (negative value is not allowed)";
+        }
+        break;
+      case 13:   // --filled-file
+        param.filledFilename = optarg;
+        break;
+      case 14:   // --fourier
+        if (std::sscanf(optarg, "%d", &param.nFourier) != 1) {
+          throw "Invalid option argument: --fourier";
+        }
+        if (param.nFourier < 1) {
+          throw "Invalid value for option argument: --fourier (must be positive)";
+        }
+        break;
+      case 15:   // --regions
+        param.isRegions = true;
+        break;
+      case 16:   // --min-area
+        if (std::sscanf(optarg, "%d", &param.minArea) != 1) {
+          throw "Invalid option argument: --min-area";
+        }
+        if (param.minArea < 1) {
+          throw "Invalid value for option argument: --min-area (must be positive)";
+        }
+        break;
+      case 17:   // --cache
+        param.cacheDirname = optarg;
+        break;
+      case 18:   // --cache-size
+        if (std::sscanf(optarg, "%d", &param.cacheSize) != 1) {
+          throw "Invalid option argument: --cache-size";
+        }
+        if (param.cacheSize < 0) {
+          throw "Invalid value for option argument: --cache-size (negative value is not allowed)";
+        }
+        break;
+      case 19:   // --plot-format
+        param.plotFormat = parsePlotFormat(optarg);
+        break;
+      case 20:   // --roi-file
+        param.roiFilename = optarg;
+        break;
+      case 21:   // --moment
+        param.momentMethod = parseMomentMethod(optarg);
+        break;
+      case 22:   // --sequence
+        param.sequenceFilename = optarg;
+        break;
+      case 23:   // --max-drift
+        if (std::sscanf(optarg, "%lf", &param.maxDrift) != 1) {
+          throw "Invalid option argument: --max-drift";
+        }
+        if (param.maxDrift < 0.0) {
+          throw "Invalid value for option argument: --max-drift (negative value is not allowed)";
+        }
+        break;
+      case 24:   // --centers
+        param.centerFlags = parseCenterFlags(optarg);
+        break;
+      case 25:   // --adaptive
+        if (std::sscanf(optarg, "%lf", &param.adaptiveThreshold) != 1) {
+          throw "Invalid option argument: --adaptive";
+        }
+        if (param.adaptiveThreshold <= 0.0) {
+          throw "Invalid value for option argument: --adaptive (must be positive)";
+        }
+        break;
       case 'c':  // -c or --color
         if (std::sscanf(optarg, "%x", reinterpret_cast<unsigned int *>(&param.plotColor)) != 1) {
           throw "Invalid option argument: -c, --color";
@@ -216,6 +849,21 @@ parseArguments(int argc, char *argv[])
         std::exit(EXIT_FAILURE);
     }
   }
+  if (param.roiFilename != nullptr && (param.batchFilename != nullptr || param.sequenceFilename != nullptr)) {
+    throw "--roi-file cannot be used with --batch/--sequence";
+  }
+  if (param.batchFilename != nullptr) {
+    if (optind != argc) {
+      throw "Invalid arguments (FILENAME can't be specified with --batch)";
+    }
+    return param;
+  }
+  if (param.sequenceFilename != nullptr) {
+    if (optind != argc) {
+      throw "Invalid arguments (FILENAME can't be specified with --sequence)";
+    }
+    return param;
+  }
   if (optind != argc - 1) {
     throw "Invalid arguments";
   }
@@ -232,7 +880,9 @@ ATTR_NOTHROW ALWAYSINLINE static void
 showUsage(const char *progname) noexcept
 {
   std::cout << "[Usage]\n"
-            << "  $ " << progname << " FILENAME [options]\n\n"
+            << "  $ " << progname << " FILENAME [options]\n"
+            << "  $ " << progname << " --batch=LIST [options]\n"
+            << "  $ " << progname << " --sequence=LIST [options]\n\n"
                "[options]\n"
                "  -c COLOR, --color=COLOR\n"
                "    specify plot color [0x000000 ~ 0xffffff]\n"
@@ -254,157 +904,2616 @@ showUsage(const char *progname) noexcept
                "  -s SIZE_STRING, --size=SIZE_STRING\n"
                "    Specify output image-size to show [WWWxHHH, RRR%, auto, original]\n"
                "      DEFAULT_VALUE = auto\n"
+               "  --adaptive=PIXELS\n"
+               "    Cast the rays by 8 degrees or less first, and bisect the angles whose neighboring\n"
+               "    distances differ by more than PIXELS down to --step (only for --method=ray)\n"
+               "  --batch=LIST\n"
+               "    Evaluate all images in LIST, which is a directory or a manifest file\n"
+               "    (one image file name per line), and output all results into one file\n"
+               "  --benchmark\n"
+               "    Measure processing time with each number of threads and exit\n"
+               "  --bin-mode=MODE\n"
+               "    Specify which boundary pixel is chosen in an angular bin of contour method [max or min]\n"
+               "      DEFAULT_VALUE = max\n"
+               "  --cache=DIRNAME\n"
+               "    Cache the results of --batch in DIRNAME keyed by the hash of each image file\n"
+               "    and the parameters, and skip decoding and evaluating the cached images\n"
+               "  --cache-size=MIB\n"
+               "    Maximum size of the cache; the least recently used results are evicted\n"
+               "      DEFAULT_VALUE = 256\n"
+               "  --centers=LIST\n"
+               "    Evaluate the profiles from each center in LIST, which is comma-separated\n"
+               "    [centroid, bbox and inscribed], against one boundary index of rows and columns\n"
+               "  --fill=DIRECTION\n"
+               "    Fill the area surrounded by the line before evaluation as fillArea [x or y]\n"
+               "  --filled-file=FILENAME\n"
+               "    Write the filled (and trimmed) image to FILENAME\n"
+               "  --fourier=K\n"
+               "    Output K Fourier descriptors of the profile, normalized for scale and rotation\n"
+               "  --max-drift=PIXELS\n"
+               "    Keep the origin of the rays of --sequence while the centroid moves within PIXELS,\n"
+               "    so that only the rays which cross the changed pixels are cast again\n"
+               "    The distances are measured from the kept origin.  With 0, all rays are cast\n"
+               "    whenever the centroid moves, and the result is identical to evaluating\n"
+               "    each frame from scratch\n"
+               "      DEFAULT_VALUE = 1\n"
+               "  --method=METHOD\n"
+               "    Specify method to find the boundary for each angle [ray, contour or polar]\n"
+               "      DEFAULT_VALUE = ray\n"
+               "  --metric=METRIC\n"
+               "    Specify metric of color distance for --tolerance [linf or deltae]\n"
+               "      DEFAULT_VALUE = linf\n"
+               "  --min-area=PIXELS\n"
+               "    Drop the components smaller than PIXELS with --regions\n"
+               "      DEFAULT_VALUE = 1\n"
+               "  --moment=METHOD\n"
+               "    Specify method to calculate the moments [span or contour]\n"
+               "    (contour traces the outer boundary only, so that the holes are treated as filled)\n"
+               "      DEFAULT_VALUE = span\n"
                "  --nosave\n"
                "    Don't write result-image to file\n"
                "  --noshow\n"
-               "    Don't show result-image to window"
+               "    Don't show result-image to window\n"
+               "  --plot-format=FORMAT\n"
+               "    Specify the format of the plot [image, overlay or svg]\n"
+               "      DEFAULT_VALUE = image\n"
+               "  --profile-file=FILENAME\n"
+               "    Append the result to the binary profile file instead of csv\n"
+               "  --regions\n"
+               "    Label the connected components and evaluate each of them separately\n"
+               "  --roi-file=FILENAME\n"
+               "    Output the area and the centroid of the region in each rectangle in FILENAME\n"
+               "    (NAME,X,Y,WIDTH,HEIGHT per line) instead of the profile,\n"
+               "    which cannot be used with --batch or --sequence\n"
+               "  --sequence=LIST\n"
+               "    Evaluate the frames in LIST in order, which is a directory or a manifest file,\n"
+               "    updating the result of the previous frame with the changed pixels\n"
+               "  --step=DEGREE\n"
+               "    Specify angular step of the rays in degree\n"
+               "      DEFAULT_VALUE = 1\n"
+               "  --subpixel\n"
+               "    Refine the boundary to sub-pixel by bilinear interpolation (ray and polar method)\n"
+               "  --tolerance=DISTANCE\n"
+               "    Specify maximum color distance from object color\n"
+               "      DEFAULT_VALUE = 0 (exact match)\n"
+               "  --trim(=BLANK_SPACE)\n"
+               "    Trim the image to the region with blank-space before evaluation as fillArea\n"
+               "    argument is optional"
             << std::endl;
 }
 
 
 /*!
- * @brief Calculate moment of the filled region in image
- * @param [in] image            A filled image
- * @param [in] foregroundColor  A color of filled region
- * @return  Center of gravity of the filled region in image
+ * @brief Parse a string which specifies the method to find the boundary
+ * @param [in] methodString  "ray", "contour" or "polar"
+ * @return  Method to find the boundary
  */
-ATTR_PURE ATTR_NOTHROW CONSTEXPR_CXX14 static CvPoint
-calcMoment(const cv::Mat &image, int foregroundColor) noexcept
+static EvalMethod
+parseEvalMethod(const char *methodString)
 {
-  static const int RGB_MASK = 0x00ffffff;
-  CvPoint gp = {0, 0};
-  int cnt = 0;
-  #pragma omp parallel for
-  REP_I (i, image.rows) {
-    REP_I (j, image.cols) {
-      int rgb = (*reinterpret_cast<int *>(&image.data[i * image.step + j * image.elemSize()]) & RGB_MASK);
-      if (rgb == foregroundColor) {
-        gp.x += j;
-        gp.y += i;
-        cnt++;
-      }
-    }
+  if (!std::strcmp(methodString, "ray")) {
+    return EVAL_METHOD_RAY;
+  } else if (!std::strcmp(methodString, "contour")) {
+    return EVAL_METHOD_CONTOUR;
+  } else if (!std::strcmp(methodString, "polar")) {
+    return EVAL_METHOD_POLAR;
+  } else {
+    throw "Invalid option argument: --method";
   }
-  std::printf("cnt = %d\n", cnt);
-  if (cnt == 0) {
-    gp.x = -1;
-    gp.y = -1;
+}
+
+
+/*!
+ * @brief Parse a string which specifies the pixel to choose in an angular bin
+ * @param [in] modeString  "max" or "min"
+ * @return  Pixel to choose in an angular bin
+ */
+static BinMode
+parseBinMode(const char *modeString)
+{
+  if (!std::strcmp(modeString, "max")) {
+    return BIN_MODE_MAX;
+  } else if (!std::strcmp(modeString, "min")) {
+    return BIN_MODE_MIN;
   } else {
-    gp.x /= cnt;
-    gp.y /= cnt;
+    throw "Invalid option argument: --bin-mode";
   }
-  return gp;
 }
 
 
 /*!
- * @brief Calculate metrics of image for evaluation
- * @param [in] image            A filled image
- * @param [in] gp               Center of gravity of the filled region in image
- * @param [in] foregroundColor  A color of filled region
- * @return  A metrics for evaluation
- */
-ATTR_NOTHROW static std::vector<CvPoint>
-evalArea(const cv::Mat &image, const CvPoint &gp, int foregroundColor) noexcept
-{
-  static const int    RGB_MASK    = 0x00ffffff;
-  static const double DEGREE_STEP = 1.0;
-  static const double DEGREE_MAX  = 180.0;
-
-  std::vector<CvPoint> crossPoints1;
-  std::vector<CvPoint> crossPoints2;
-  for (double theta = 0.0; theta < DEGREE_MAX; theta += DEGREE_STEP) {
-    double a = std::tan(degreeToRadian(theta));
-    double b = gp.y - gp.x * a;
-    int rest = (static_cast<int>(theta) / 45) % 4;
-    if (rest == 1 || rest == 2) {  // y-based
-      FOR (y, gp.y, image.rows) {
-        int x = static_cast<int>(round((y - b) / a));
-        x = clipping(x, 0, image.cols - 1);
-        int rgb = (*reinterpret_cast<int *>(&image.data[y * image.step + x * image.elemSize()]) & RGB_MASK);
-        if (rgb != foregroundColor || y == image.rows - 1 || x == 0 || x == image.cols - 1) {
-          CvPoint crossPoint = {x, y};
-          crossPoints1.push_back(crossPoint);
-          break;
-        }
-      }
-      RFOR (y, gp.y, 0) {
-        int x = static_cast<int>(round((y - b) / a));
-        x = clipping(x, 0, image.cols - 1);
-        int rgb = (*reinterpret_cast<int *>(&image.data[y * image.step + x * image.elemSize()]) & RGB_MASK);
-        if (rgb != foregroundColor || y == 0 || x == 0 || x == image.cols - 1) {
-          CvPoint crossPoint = {x, y};
-          crossPoints2.push_back(crossPoint);
-          break;
-        }
-      }
-    } else {  // x-based
-      FOR (x, gp.x, image.cols) {
-        int y = static_cast<int>(round(x * a + b));
-        y = clipping(y, 0, image.rows - 1);
-        int rgb = (*reinterpret_cast<int *>(&image.data[y * image.step + x * image.elemSize()]) & RGB_MASK);
-        if (rgb != foregroundColor || x == 0 || x == image.cols - 1 || y == 0 || y == image.rows - 1) {
-          CvPoint crossPoint = {x, y};
-          crossPoints1.push_back(crossPoint);
-          break;
-        }
-      }
-      RFOR (x, gp.x, 0) {
-        int y = static_cast<int>(round(x * a + b));
-        y = clipping(y, 0, image.rows - 1);
-        int rgb = (*reinterpret_cast<int *>(&image.data[y * image.step + x * image.elemSize()]) & RGB_MASK);
-        if (rgb != foregroundColor || x == 0 || x == image.cols - 1  || y == 0 || y == image.rows - 1) {
-          CvPoint crossPoint = {x, y};
-          crossPoints2.push_back(crossPoint);
-          break;
-        }
-      }
+ * @brief Parse a string which specifies the direction to fill the image
+ * @param [in] modeString  "x" or "y"
+ * @return  Direction to fill the image
+ */
+static FillMode
+parseFillMode(const char *modeString)
+{
+  if (!std::strcmp(modeString, "x")) {
+    return FILL_MODE_X;
+  } else if (!std::strcmp(modeString, "y")) {
+    return FILL_MODE_Y;
+  } else {
+    throw "Invalid option argument: --fill";
+  }
+}
+
+
+/*!
+ * @brief Parse the format of the plot
+ * @param [in] formatString  A string of the format ("image", "overlay" or "svg")
+ * @return  The format
+ */
+static PlotFormat
+parsePlotFormat(const char *formatString)
+{
+  if (!std::strcmp(formatString, "image")) {
+    return PLOT_FORMAT_IMAGE;
+  } else if (!std::strcmp(formatString, "overlay")) {
+    return PLOT_FORMAT_OVERLAY;
+  } else if (!std::strcmp(formatString, "svg")) {
+    return PLOT_FORMAT_SVG;
+  } else {
+    throw "Invalid option argument: --plot-format";
+  }
+}
+
+
+/*!
+ * @brief Parse the method to calculate the moments
+ * @param [in] methodString  A string of the method ("span" or "contour")
+ * @return  The method
+ */
+static MomentMethod
+parseMomentMethod(const char *methodString)
+{
+  if (!std::strcmp(methodString, "span")) {
+    return MOMENT_METHOD_SPAN;
+  } else if (!std::strcmp(methodString, "contour")) {
+    return MOMENT_METHOD_CONTOUR;
+  } else {
+    throw "Invalid option argument: --moment";
+  }
+}
+
+
+/*!
+ * @brief Parse the comma-separated list of the types of center
+ * @param [in] listString  A string of the list ("centroid", "bbox" and "inscribed")
+ * @return  Bit flags of CenterType
+ */
+static int
+parseCenterFlags(const char *listString)
+{
+  int flags = 0;
+  std::string list(listString);
+  std::string::size_type pos = 0;
+  for (;;) {
+    std::string::size_type idx = list.find(',', pos);
+    std::string name = list.substr(pos, idx == std::string::npos ? std::string::npos : idx - pos);
+    int i = 0;
+    while (i < N_CENTER_TYPES && name != CENTER_TYPE_NAMES[i]) {
+      i++;
+    }
+    if (i == N_CENTER_TYPES) {
+      throw "Invalid option argument: --centers";
+    }
+    flags |= 1 << i;
+    if (idx == std::string::npos) {
+      break;
     }
+    pos = idx + 1;
   }
-  crossPoints1.insert(crossPoints1.end(), crossPoints2.begin(), crossPoints2.end());
-  return crossPoints1;
+  return flags;
 }
 
 
 /*!
- * @brief Plot points of metrics on the image
- * @param [in] image        A filled image
- * @param [in] crossPoints  Points in the boundary of the region
- * @param [in] plotColor    A color for plotting
- * @return  Plotted image
+ * @brief Fill and trim the image in the same way as fillArea
+ *
+ * The result is identical to the image which fillArea writes, so that
+ * evaluating it gives the same result as evaluating the image file which
+ * fillArea writes without encoding and decoding it.
+ * @param [in,out] image      A image.  It is filled in place.
+ * @param [in]     matcher    Classifier of the color of line and area
+ * @param [in]     fillMode   Direction to fill the image
+ * @param [in]     trimBlank  Blank space around the trimmed region (-1 means no trimming)
+ * @return  The filled and trimmed image, which shares the data with image
  */
 ATTR_NOTHROW static cv::Mat
-plotCrossPoints(const cv::Mat &image, const std::vector<CvPoint> &crossPoints, int plotColor) noexcept
+fillImage(cv::Mat &image, const ColorMatcher &matcher, FillMode fillMode, int trimBlank) noexcept
 {
-  cv::Mat plottedImage = image.clone();
-  cv::Scalar color(
-      (plotColor & B_MASK),
-      (plotColor & G_MASK) >> 8,
-      (plotColor & R_MASK) >> 16
-  );
-  FOREACH(cp, crossPoints) {
-    cv::circle(plottedImage, cv::Point(cp->x, cp->y), 1, color, -1, CV_AA);
+  switch (fillMode) {
+    case FILL_MODE_X:
+      fillAreaXBase(image, matcher, nullptr);
+      break;
+    case FILL_MODE_Y:
+      fillAreaYBase(image, matcher, nullptr);
+      break;
+    case FILL_MODE_NONE:
+      break;
+  }
+  if (trimBlank == -1) {
+    return image;
+  }
+  cv::Rect areaRect = searchArea(image, matcher);
+  if (areaRect.width < 0) {
+    return image;
   }
-  return plottedImage;
+  return image(addBlankToRect(cv::Size(image.cols, image.rows), areaRect, trimBlank));
 }
 
 
 /*!
- * @brief Calculates the distance to the position where the boundary of the
- *        region from the center of gravity
+ * @brief Calculate moments of the filled region in image
  *
- * @param [in] gp           Center of gravity point
- * @param [in] crossPoints  Points in the boundary of the region
- * @return The distance to the position where the boundary of the region from
- *         the center of gravity
+ * The sums of each span are calculated in closed form.  First order sums are
+ * accumulated with 64-bit integers, and second order sums of each row, which
+ * are exact with 64-bit integers, are accumulated with double.
+ * Each thread accumulates the sums of its rows in its own partial sums, and
+ * the partial sums are merged in order of the thread number, so that the
+ * result doesn't depend on scheduling.
+ * @param [in] index  Run-length representation of the filled region
+ * @return  Raw moments of the filled region up to second order
  */
-ATTR_NOTHROW static std::vector<double>
-calcResults(const CvPoint &gp, const std::vector<CvPoint> &crossPoints) noexcept
+ATTR_NOTHROW static Moments
+calcMoment(const SpanIndex &index) noexcept
+{
+#ifdef _OPENMP
+  std::vector<MomentSums> partials(static_cast<size_t>(omp_get_max_threads()));
+#else
+  std::vector<MomentSums> partials(1);
+#endif
+  #pragma omp parallel
+  {
+#ifdef _OPENMP
+    MomentSums &partial = partials[static_cast<size_t>(omp_get_thread_num())];
+#else
+    MomentSums &partial = partials[0];
+#endif
+    long long cnt   = 0;
+    long long sumX  = 0;
+    long long sumY  = 0;
+    double    sumXX = 0.0;
+    double    sumXY = 0.0;
+    double    sumYY = 0.0;
+    #pragma omp for schedule(static)
+    REP_I (i, index.height) {
+      long long rowCnt   = 0;
+      long long rowSumX  = 0;
+      long long rowSumXX = 0;
+      FOR (k, index.rowOffsets[i], index.rowOffsets[i + 1]) {
+        const Span &span = index.spans[k];
+        long long b = span.begin;
+        long long e = span.end;
+        rowCnt   += e - b;
+        rowSumX  += (b + e - 1) * (e - b) / 2;
+        rowSumXX += ((e - 1) * e * (2 * e - 1) - (b - 1) * b * (2 * b - 1)) / 6;
+      }
+      cnt   += rowCnt;
+      sumX  += rowSumX;
+      sumY  += i * rowCnt;
+      sumXX += static_cast<double>(rowSumXX);
+      sumXY += static_cast<double>(i * rowSumX);
+      sumYY += static_cast<double>(i) * static_cast<double>(i * rowCnt);
+    }
+    partial.cnt   = cnt;
+    partial.sumX  = sumX;
+    partial.sumY  = sumY;
+    partial.sumXX = sumXX;
+    partial.sumXY = sumXY;
+    partial.sumYY = sumYY;
+  }
+
+  long long cnt  = 0;
+  long long sumX = 0;
+  long long sumY = 0;
+  Moments moments = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  FOREACH (partial, partials) {
+    cnt  += partial->cnt;
+    sumX += partial->sumX;
+    sumY += partial->sumY;
+    moments.m20 += partial->sumXX;
+    moments.m11 += partial->sumXY;
+    moments.m02 += partial->sumYY;
+  }
+  moments.m00 = static_cast<double>(cnt);
+  moments.m10 = static_cast<double>(sumX);
+  moments.m01 = static_cast<double>(sumY);
+  return moments;
+}
+
+
+/*!
+ * @brief Calculate moments of the filled region from its outer boundary
+ *
+ * The outer boundary is traced once along the edges between the pixels,
+ * keeping the region on the right side, from the top-left corner of the
+ * first span.  The region is 8-connected, so that the tracer turns left if
+ * the pixel ahead on the left is in the region, goes straight if the pixel
+ * ahead on the right is in the region, and turns right otherwise.
+ * The edges between the corners of the boundary polygon are summed up by
+ * Green's theorem, whose signed area is positive in this direction in image,
+ * and the moments of the polygon are converted into the sums over the pixels, which are exact with 64-bit integers.  The cost is
+ * proportional to the perimeter, not to the area or the number of the spans.
+ * Only the boundary of the component which has the first span is traced,
+ * and its holes are treated as filled, so that the result is identical to
+ * calcMoment() for a region of a single component without holes.
+ * @param [in] index  Run-length representation of the filled region
+ * @return  Raw moments of the filled region up to second order
+ */
+ATTR_NOTHROW static Moments
+calcMomentByContour(const SpanIndex &index) noexcept
+{
+  Moments moments = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  if (index.spans.empty()) {
+    return moments;
+  }
+  int startY = 0;
+  while (index.rowOffsets[static_cast<size_t>(startY) + 1] == 0) {
+    startY++;
+  }
+  int startX = index.spans[0].begin;
+
+  EdgeSums sums = {0, 0, 0, 0, 0, 0};
+  int x = startX;
+  int y = startY;
+  int dx = 1;
+  int dy = 0;
+  int cornerX = x;
+  int cornerY = y;
+  do {
+    x += dx;
+    y += dy;
+    // The pixels ahead on the left and on the right, whose corner is (x, y)
+    int leftX  = x + (dx + dy > 0 ? 0 : -1);
+    int leftY  = y + (dy - dx > 0 ? 0 : -1);
+    int rightX = x + (dx - dy > 0 ? 0 : -1);
+    int rightY = y + (dy + dx > 0 ? 0 : -1);
+    int ndx;
+    int ndy;
+    if (findSpan(index, leftX, leftY) != nullptr) {
+      ndx = dy;
+      ndy = -dx;
+    } else if (findSpan(index, rightX, rightY) != nullptr) {
+      ndx = dx;
+      ndy = dy;
+    } else {
+      ndx = -dy;
+      ndy = dx;
+    }
+    if (ndx != dx || ndy != dy) {
+      addEdgeSums(sums, cornerX, cornerY, x, y);
+      cornerX = x;
+      cornerY = y;
+      dx = ndx;
+      dy = ndy;
+    }
+  } while (x != startX || y != startY || dx != 1 || dy != 0);
+  addEdgeSums(sums, cornerX, cornerY, startX, startY);
+
+  // The integral over the pixel at (px, py) is px + 1/2, px^2 + px + 1/3 and (px + 1/2) * (py + 1/2)
+  long long sumX = (2 * sums.s10 - 3 * sums.s00) / 12;
+  long long sumY = (2 * sums.s01 - 3 * sums.s00) / 12;
+  moments.m00 = static_cast<double>(sums.s00 / 2);
+  moments.m10 = static_cast<double>(sumX);
+  moments.m01 = static_cast<double>(sumY);
+  moments.m20 = static_cast<double>((sums.s20 - 12 * sumX - 2 * sums.s00) / 12);
+  moments.m11 = static_cast<double>((sums.s11 - 12 * (sumX + sumY) - 3 * sums.s00) / 24);
+  moments.m02 = static_cast<double>((sums.s02 - 12 * sumY - 2 * sums.s00) / 12);
+  return moments;
+}
+
+
+/*!
+ * @brief Add the sums of the edge of the boundary polygon for moment
+ * @param [in,out] sums  Sums of the edges
+ * @param [in]     x0    X-position of the start of the edge
+ * @param [in]     y0    Y-position of the start of the edge
+ * @param [in]     x1    X-position of the end of the edge
+ * @param [in]     y1    Y-position of the end of the edge
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+addEdgeSums(EdgeSums &sums, long long x0, long long y0, long long x1, long long y1) noexcept
+{
+  long long c = x0 * y1 - x1 * y0;
+  sums.s00 += c;
+  sums.s10 += (x0 + x1) * c;
+  sums.s01 += (y0 + y1) * c;
+  sums.s20 += (x0 * x0 + x0 * x1 + x1 * x1) * c;
+  sums.s11 += (x0 * y1 + 2 * x0 * y0 + 2 * x1 * y1 + x1 * y0) * c;
+  sums.s02 += (y0 * y0 + y0 * y1 + y1 * y1) * c;
+}
+
+
+/*!
+ * @brief Calculate shape features from moments
+ *
+ * The principal axes are the ones of the ellipse which has the same second
+ * central moments as the region.  If the region is empty, the center of
+ * gravity is (-1, -1).
+ * @param [in] moments  Raw moments of the region up to second order
+ * @return  Shape features of the region
+ */
+ATTR_NOTHROW static ShapeFeatures
+calcShapeFeatures(const Moments &moments) noexcept
 {
-  std::vector<double> scores;
-  FOREACH (cp, crossPoints) {
-    double distance = calcDistance(gp, *cp);
-    scores.push_back(distance);
+  ShapeFeatures features = {-1.0, -1.0, 0.0, 0.0, 0.0, 0.0};
+  if (moments.m00 < 1.0) {
+    return features;
+  }
+  features.centroidX = moments.m10 / moments.m00;
+  features.centroidY = moments.m01 / moments.m00;
+
+  // Normalized second central moments
+  double mu20 = moments.m20 / moments.m00 - features.centroidX * features.centroidX;
+  double mu11 = moments.m11 / moments.m00 - features.centroidX * features.centroidY;
+  double mu02 = moments.m02 / moments.m00 - features.centroidY * features.centroidY;
+  double common  = std::sqrt(4.0 * mu11 * mu11 + (mu20 - mu02) * (mu20 - mu02));
+  double lambda1 = (mu20 + mu02 + common) / 2.0;
+  double lambda2 = std::max((mu20 + mu02 - common) / 2.0, 0.0);
+
+  features.majorAxis    = 2.0 * std::sqrt(lambda1);
+  features.minorAxis    = 2.0 * std::sqrt(lambda2);
+  features.orientation  = radianToDegree(0.5 * std::atan2(2.0 * mu11, mu20 - mu02));
+  features.eccentricity = lambda1 > 0.0 ? std::sqrt(1.0 - lambda2 / lambda1) : 0.0;
+  return features;
+}
+
+
+/*!
+ * @brief Find the boundary of the region for each angle with the specified
+ *        method
+ * @param [in] index       Run-length representation of the filled region
+ * @param [in] gp          Center of gravity of the filled region in image
+ * @param [in] degreeStep  Angular step in degree
+ * @param [in] method      Method to find the boundary
+ * @param [in] binMode     Pixel to choose in an angular bin of contour method
+ * @param [in] isSubpixel  Refine the boundary to sub-pixel or not (ray and
+ *                         polar method)
+ * @return  Points in the boundary of the region for each angle
+ */
+static CrossPoints
+calcProfile(const SpanIndex &index, const cv::Point2d &gp, double degreeStep, EvalMethod method, BinMode binMode, bool isSubpixel)
+{
+  switch (method) {
+    case EVAL_METHOD_CONTOUR:
+      return evalAreaByContour(index, gp, degreeStep, binMode);
+    case EVAL_METHOD_POLAR:
+      return evalAreaByPolar(index, gp, degreeStep, isSubpixel);
+    case EVAL_METHOD_RAY:
+    default:
+      {
+        SpanIndex columns;
+        transposeSpanIndex(index, columns);
+        return evalArea(index, columns, gp, degreeStep, isSubpixel);
+      }
+  }
+}
+
+
+/*!
+ * @brief Calculate metrics of image for evaluation
+ *
+ * The rays are cast from the center of gravity by degreeStep from zero degree,
+ * where the angle is measured clockwise from the positive direction of x-axis
+ * in the image.  Each ray is independent, so that they are cast in parallel.
+ * The index of the columns can be shared by the rays from any number of
+ * origins.
+ * @param [in] index       Run-length representation of the filled region
+ * @param [in] columns     Run-length representation of the columns, which
+ *                         transposeSpanIndex() gives
+ * @param [in] gp          Center of gravity of the filled region in image,
+ *                         which is the origin of the rays
+ * @param [in] degreeStep  Angular step of the rays in degree
+ * @param [in] isSubpixel  Refine the boundary to sub-pixel or not
+ * @return  Points in the boundary of the region for each angle
+ */
+ATTR_NOTHROW static CrossPoints
+evalArea(const SpanIndex &index, const SpanIndex &columns, const cv::Point2d &gp, double degreeStep, bool isSubpixel) noexcept
+{
+  int nRays = countRays(degreeStep);
+  CrossPoints crossPoints;
+  crossPoints.xs.resize(static_cast<size_t>(nRays));
+  crossPoints.ys.resize(static_cast<size_t>(nRays));
+  #pragma omp parallel for schedule(dynamic, 16)
+  REP_I (i, nRays) {
+    cv::Point2d cp = castRay(index, columns, gp, i * degreeStep, isSubpixel);
+    crossPoints.xs[static_cast<size_t>(i)] = cp.x;
+    crossPoints.ys[static_cast<size_t>(i)] = cp.y;
+  }
+  return crossPoints;
+}
+
+
+/*!
+ * @brief Calculate metrics of image for evaluation with the angular step
+ *        which adapts to the boundary
+ *
+ * The rays are cast by the coarse step first, which is degreeStep multiplied
+ * by the largest power of two up to ADAPTIVE_COARSE_STEP.  Then each angular
+ * interval is bisected while the distances of its ends differ by more than
+ * the threshold and it is wider than degreeStep.  Each level of the bisection
+ * is cast in parallel.  All angles are multiples of degreeStep and the rays
+ * are identical to the ones of evalArea(), so that the result is a subset of
+ * the result of evalArea() where the boundary is smooth.
+ * A feature which is narrower than the coarse step may be missed if the
+ * distances of the both ends of its interval are close.
+ * @param [in]  index       Run-length representation of the filled region
+ * @param [in]  columns     Run-length representation of the columns
+ * @param [in]  gp          Origin of the rays
+ * @param [in]  degreeStep  The finest angular step of the rays in degree
+ * @param [in]  threshold   Difference of the distances to bisect the interval
+ * @param [in]  isSubpixel  Refine the boundary to sub-pixel or not
+ * @param [out] angles      The angles of the points in degree
+ * @return  Points in the boundary of the region in the order of the angles
+ */
+ATTR_NOTHROW static CrossPoints
+evalAreaAdaptive(const SpanIndex &index, const SpanIndex &columns, const cv::Point2d &gp, double degreeStep, double threshold, bool isSubpixel, std::vector<double> &angles) noexcept
+{
+  int nRays = countRays(degreeStep);
+  int stride = 1;
+  while (stride * 2 < nRays && stride * 2 * degreeStep <= ADAPTIVE_COARSE_STEP) {
+    stride *= 2;
+  }
+  std::vector<double> xs(static_cast<size_t>(nRays));
+  std::vector<double> ys(static_cast<size_t>(nRays));
+  std::vector<double> ds(static_cast<size_t>(nRays));
+  std::vector<unsigned char> isCast(static_cast<size_t>(nRays), 0);
+
+  // Intervals of the indices of the angles, where the end nRays is the first angle
+  std::vector<std::pair<int, int> > intervals;
+  std::vector<int> targets;
+  for (int i = 0; i < nRays; i += stride) {
+    targets.push_back(i);
+    intervals.push_back(std::make_pair(i, std::min(i + stride, nRays)));
+  }
+  while (!targets.empty()) {
+    int nTargets = static_cast<int>(targets.size());
+    #pragma omp parallel for schedule(dynamic, 16)
+    REP_I (j, nTargets) {
+      size_t i = static_cast<size_t>(targets[static_cast<size_t>(j)]);
+      cv::Point2d cp = castRay(index, columns, gp, static_cast<int>(i) * degreeStep, isSubpixel);
+      xs[i] = cp.x;
+      ys[i] = cp.y;
+      ds[i] = std::sqrt((cp.x - gp.x) * (cp.x - gp.x) + (cp.y - gp.y) * (cp.y - gp.y));
+      isCast[i] = 1;
+    }
+    targets.clear();
+    std::vector<std::pair<int, int> > nextIntervals;
+    FOREACH (interval, intervals) {
+      int begin = interval->first;
+      int end   = interval->second;
+      if (end - begin < 2 || std::fabs(ds[static_cast<size_t>(begin)] - ds[static_cast<size_t>(end % nRays)]) <= threshold) {
+        continue;
+      }
+      int mid = begin + (end - begin) / 2;
+      targets.push_back(mid);
+      nextIntervals.push_back(std::make_pair(begin, mid));
+      nextIntervals.push_back(std::make_pair(mid, end));
+    }
+    intervals.swap(nextIntervals);
+  }
+
+  CrossPoints crossPoints;
+  angles.clear();
+  REP_I (i, nRays) {
+    if (isCast[static_cast<size_t>(i)] != 0) {
+      angles.push_back(i * degreeStep);
+      crossPoints.xs.push_back(xs[static_cast<size_t>(i)]);
+      crossPoints.ys.push_back(ys[static_cast<size_t>(i)]);
+    }
+  }
+  return crossPoints;
+}
+
+
+/*!
+ * @brief Resample the distances of the adaptive sampling to the uniform step
+ *
+ * The distance at each angle is linearly interpolated between the nearest
+ * sampled angles, where the first sampled angle follows the last one.
+ * @param [in] angles      The sampled angles in ascending order
+ * @param [in] distances   The distances for each sampled angle
+ * @param [in] degreeStep  Angular step in degree
+ * @return  The distances for each angle of the uniform step
+ */
+static std::vector<double>
+resampleProfile(const std::vector<double> &angles, const std::vector<double> &distances, double degreeStep)
+{
+  int nRays = countRays(degreeStep);
+  std::vector<double> resampled(static_cast<size_t>(nRays));
+  if (angles.empty()) {
+    return resampled;
+  }
+  size_t nPoints = angles.size();
+  size_t k = 0;
+  REP_I (i, nRays) {
+    double theta = i * degreeStep;
+    while (k < nPoints && angles[k] <= theta) {
+      k++;
+    }
+    // The interval [angles[prev], angles[next]) contains theta
+    size_t prev = k == 0 ? nPoints - 1 : k - 1;
+    size_t next = k == nPoints ? 0 : k;
+    double a0 = angles[prev];
+    double a1 = angles[next];
+    if (a0 > theta) {
+      a0 -= 360.0;
+    }
+    if (a1 <= a0) {
+      a1 += 360.0;
+    }
+    double t = (theta - a0) / (a1 - a0);
+    resampled[static_cast<size_t>(i)] = distances[prev] + (distances[next] - distances[prev]) * t;
+  }
+  return resampled;
+}
+
+
+/*!
+ * @brief Cast a ray from the origin and find the point where the ray goes out
+ *        of the region
+ *
+ * The ray is traversed by the incremental DDA along its major axis.  The
+ * position on the minor axis is held in fixed-point whose fractional part is
+ * offset by 0.5, so that taking the integer part is equivalent to rounding,
+ * and no division or rounding is done in each step.
+ * As same as the line equation y = ax + b, the rays whose angle modulo 180 is
+ * in [45, 135) are traversed along y-axis and search the runs of the columns,
+ * and others are traversed along x-axis and search the runs of the rows.
+ * The ray does not walk the pixels but jumps to the end of the run which
+ * contains the current sample (see findRayExit()).
+ * If isSubpixel is true and the ray goes out of the region, the crossing is
+ * refined between the last inside sample and the first outside sample.
+ * @param [in] index       Run-length representation of the filled region
+ * @param [in] columns     Run-length representation of the columns
+ * @param [in] gp          Origin of the ray
+ * @param [in] theta       Angle of the ray in degree
+ * @param [in] isSubpixel  Refine the crossing to sub-pixel or not
+ * @return  The first point which is out of the region or on the border of the
+ *          image
+ */
+ATTR_NOTHROW static cv::Point2d
+castRay(const SpanIndex &index, const SpanIndex &columns, const cv::Point2d &gp, double theta, bool isSubpixel) noexcept
+{
+  static const int       FIXED_SHIFT = 32;
+  static const double    FIXED_ONE   = static_cast<double>(1LL << FIXED_SHIFT);
+  static const long long FIXED_HALF  = 1LL << (FIXED_SHIFT - 1);
+
+  double c = std::cos(degreeToRadian(theta));
+  double s = std::sin(degreeToRadian(theta));
+  double rest = std::fmod(theta, 180.0);
+  bool isXBase = rest < 45.0 || 135.0 <= rest;
+  int x;
+  int y;
+  bool isInside;
+  if (isXBase) {
+    int x0 = static_cast<int>(round(gp.x));
+    int dx = c < 0.0 ? -1 : 1;
+    double a = s / c;
+    long long slope = static_cast<long long>(a * dx * FIXED_ONE);
+    long long yFixed = static_cast<long long>((gp.y + (x0 - gp.x) * a) * FIXED_ONE) + FIXED_HALF;
+    if (findRayExit(index, x0, dx, yFixed, slope, x, y, isInside)) {
+      if (isSubpixel && !isInside && x != x0) {
+        return refineCrossPoint(index,
+            cv::Point2d(x - dx, gp.y + (x - dx - gp.x) * a),
+            cv::Point2d(x, gp.y + (x - gp.x) * a));
+      }
+      return cv::Point2d(x, y);
+    }
+  } else {
+    int y0 = static_cast<int>(round(gp.y));
+    int dy = s < 0.0 ? -1 : 1;
+    double a = c / s;
+    long long slope = static_cast<long long>(a * dy * FIXED_ONE);
+    long long xFixed = static_cast<long long>((gp.x + (y0 - gp.y) * a) * FIXED_ONE) + FIXED_HALF;
+    if (findRayExit(columns, y0, dy, xFixed, slope, y, x, isInside)) {
+      if (isSubpixel && !isInside && y != y0) {
+        return refineCrossPoint(index,
+            cv::Point2d(gp.x + (y - dy - gp.y) * a, y - dy),
+            cv::Point2d(gp.x + (y - gp.y) * a, y));
+      }
+      return cv::Point2d(x, y);
+    }
+  }
+  return cv::Point2d(
+      clipping(static_cast<int>(round(gp.x)), 0, index.width - 1),
+      clipping(static_cast<int>(round(gp.y)), 0, index.height - 1));
+}
+
+
+/*!
+ * @brief Find the first sample of the ray which is out of the region or on
+ *        the border of the image
+ *
+ * The ray is traversed along the lines (the rows or the columns), where the
+ * position on the minor axis is in fixed-point.  While
+ * the position on the minor axis stays in a line, the samples are in the run
+ * of the line which contains the current sample until the end of the run, so
+ * that the ray jumps to the end of the run or to the next line at once.
+ * @param [in]  lines       Run-length representation of the lines
+ * @param [in]  major0      The first position on the major axis
+ * @param [in]  step        Direction on the major axis (1 or -1)
+ * @param [in]  minorFixed  The first position on the minor axis in fixed-point
+ * @param [in]  slope       Increment of the position on the minor axis in fixed-point
+ * @param [out] major       Position of the sample on the major axis
+ * @param [out] minor       Position of the sample on the minor axis
+ * @param [out] isInside    The sample is in the region or not
+ * @return  true if the sample is found, false if the first position is out
+ *          of the image
+ */
+ATTR_NOTHROW static bool
+findRayExit(const SpanIndex &lines, int major0, int step, long long minorFixed, long long slope, int &major, int &minor, bool &isInside) noexcept
+{
+  static const int FIXED_SHIFT = 32;
+
+  for (major = major0; 0 <= major && major < lines.width;) {
+    long long line = minorFixed >> FIXED_SHIFT;
+    minor = clipping(static_cast<int>(line), 0, lines.height - 1);
+    const Span *span = findSpan(lines, major, minor);
+    isInside = span != nullptr;
+    if (!isInside || major == 0 || major == lines.width - 1 || minor == 0 || minor == lines.height - 1) {
+      return true;
+    }
+    // The number of the following samples which stay in this line
+    long long nStays = lines.width;
+    if (((minorFixed + slope) >> FIXED_SHIFT) != line) {
+      nStays = 0;
+    } else if (slope > 0) {
+      nStays = (((line + 1) << FIXED_SHIFT) - 1 - minorFixed) / slope;
+    } else if (slope < 0) {
+      nStays = (minorFixed - (line << FIXED_SHIFT)) / -slope;
+    }
+    // The first sample which is out of the run or on the border in this line
+    int limit = step > 0 ? std::min(span->end, lines.width - 1) : std::max(span->begin - 1, 0);
+    long long nSteps = (limit - major) * step;
+    if (nSteps > nStays) {
+      nSteps = nStays + 1;
+    }
+    major += static_cast<int>(nSteps) * step;
+    minorFixed += nSteps * slope;
+  }
+  return false;
+}
+
+
+/*!
+ * @brief Refine the crossing of the ray and the boundary to sub-pixel
+ *
+ * The coverage of the region is interpolated bilinearly at the two samples on
+ * the exact ray, and the crossing is the point where the coverage is 0.5 on
+ * the linear interpolation between them.
+ * @param [in] index    Run-length representation of the filled region
+ * @param [in] inside   The point on the ray of the last inside sample
+ * @param [in] outside  The point on the ray of the first outside sample
+ * @return  Refined crossing point
+ */
+ATTR_NOTHROW static cv::Point2d
+refineCrossPoint(const SpanIndex &index, const cv::Point2d &inside, const cv::Point2d &outside) noexcept
+{
+  static const double EPS = 1.0e-6;
+
+  double fIn  = sampleCoverage(index, inside);
+  double fOut = sampleCoverage(index, outside);
+  double t = fIn - fOut > EPS ? clipping((fIn - 0.5) / (fIn - fOut), 0.0, 1.0) : 0.5;
+  return cv::Point2d(inside.x + (outside.x - inside.x) * t, inside.y + (outside.y - inside.y) * t);
+}
+
+
+/*!
+ * @brief Sample the coverage of the region at the sub-pixel position
+ *
+ * The pixels are regarded as 1 in the region and 0 out of the region
+ * (including out of the image), and they are interpolated bilinearly.
+ * @param [in] index  Run-length representation of the filled region
+ * @param [in] p      Sub-pixel position
+ * @return  Coverage in [0, 1]
+ */
+ATTR_NOTHROW static double
+sampleCoverage(const SpanIndex &index, const cv::Point2d &p) noexcept
+{
+  int x = static_cast<int>(std::floor(p.x));
+  int y = static_cast<int>(std::floor(p.y));
+  double fx = p.x - x;
+  double fy = p.y - y;
+  double v00 = findSpan(index, x, y) != nullptr ? 1.0 : 0.0;
+  double v10 = findSpan(index, x + 1, y) != nullptr ? 1.0 : 0.0;
+  double v01 = findSpan(index, x, y + 1) != nullptr ? 1.0 : 0.0;
+  double v11 = findSpan(index, x + 1, y + 1) != nullptr ? 1.0 : 0.0;
+  return (v00 * (1.0 - fx) + v10 * fx) * (1.0 - fy) + (v01 * (1.0 - fx) + v11 * fx) * fy;
+}
+
+
+/*!
+ * @brief Calculate metrics of image for evaluation from the contour of the
+ *        region
+ *
+ * The outer boundary of the largest region is traced once, and each pixel of
+ * it is put into the angular bin around the center of gravity.  In each bin,
+ * the farthest or nearest pixel is chosen.  The cost is proportional to the
+ * perimeter instead of the number of rays times the radius.
+ * The bins which have no pixel, which occur when the step is finer than the
+ * pixels of the boundary, are interpolated linearly in the distance between
+ * the nearest non-empty bins on both sides.
+ * @param [in] index       Run-length representation of the filled region
+ * @param [in] gp          Center of gravity of the filled region in image
+ * @param [in] degreeStep  Angular step of the bins in degree
+ * @param [in] binMode     Pixel to choose in a bin
+ * @return  Points in the boundary of the region for each angle
+ */
+static CrossPoints
+evalAreaByContour(const SpanIndex &index, const cv::Point2d &gp, double degreeStep, BinMode binMode)
+{
+  int nBins = countRays(degreeStep);
+  CrossPoints crossPoints;
+  crossPoints.xs.assign(static_cast<size_t>(nBins), gp.x);
+  crossPoints.ys.assign(static_cast<size_t>(nBins), gp.y);
+
+  cv::Mat mask;
+  spanIndexToMask(index, mask);
+  std::vector<std::vector<cv::Point> > contours;
+  cv::findContours(mask, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE);
+  if (contours.empty()) {
+    return crossPoints;
+  }
+  size_t largest = 0;
+  double largestArea = -1.0;
+  REP (i, contours.size()) {
+    double area = std::fabs(cv::contourArea(contours[i]));
+    if (largestArea < area) {
+      largestArea = area;
+      largest = i;
+    }
+  }
+
+  std::vector<double> distances(static_cast<size_t>(nBins), -1.0);
+  FOREACH (pt, contours[largest]) {
+    double dx = pt->x - gp.x;
+    double dy = pt->y - gp.y;
+    double theta = radianToDegree(std::atan2(dy, dx));
+    if (theta < 0.0) {
+      theta += 360.0;
+    }
+    size_t bin = static_cast<size_t>(static_cast<int>(round(theta / degreeStep)) % nBins);
+    double distance = std::sqrt(dx * dx + dy * dy);
+    if (distances[bin] < 0.0
+        || (binMode == BIN_MODE_MAX && distances[bin] < distance)
+        || (binMode == BIN_MODE_MIN && distance < distances[bin])) {
+      distances[bin] = distance;
+      crossPoints.xs[bin] = pt->x;
+      crossPoints.ys[bin] = pt->y;
+    }
+  }
+
+  // Interpolate empty bins between the previous and next non-empty bins
+  int first = 0;
+  while (first < nBins && distances[static_cast<size_t>(first)] < 0.0) {
+    first++;
+  }
+  for (int prev = first; prev < first + nBins; ) {
+    int next = prev + 1;
+    while (distances[static_cast<size_t>(next % nBins)] < 0.0) {
+      next++;
+    }
+    double d0 = distances[static_cast<size_t>(prev % nBins)];
+    double d1 = distances[static_cast<size_t>(next % nBins)];
+    FOR (i, prev + 1, next) {
+      double t = static_cast<double>(i - prev) / (next - prev);
+      double distance = d0 + (d1 - d0) * t;
+      double theta = degreeToRadian((i % nBins) * degreeStep);
+      crossPoints.xs[static_cast<size_t>(i % nBins)] = gp.x + distance * std::cos(theta);
+      crossPoints.ys[static_cast<size_t>(i % nBins)] = gp.y + distance * std::sin(theta);
+    }
+    prev = next;
+  }
+  return crossPoints;
+}
+
+
+/*!
+ * @brief Calculate metrics of image for evaluation from the mask which is
+ *        warped into polar coordinates
+ *
+ * The mask of the region is warped with cvLinearPolar(), whose rows are the
+ * angles and columns are the radii in one pixel.  The boundary for each angle
+ * is the first column whose interpolated value is less than half, which is
+ * found by a scan over contiguous memory.
+ * The rows divide the circle evenly, so that the angle of each row is
+ * slightly different from the multiple of degreeStep if degreeStep doesn't
+ * divide 360.
+ * If isSubpixel is true, the boundary is interpolated linearly between the
+ * last column of the region and the first column of the background.
+ * @param [in] index       Run-length representation of the filled region
+ * @param [in] gp          Center of gravity of the filled region in image
+ * @param [in] degreeStep  Angular step in degree
+ * @param [in] isSubpixel  Refine the boundary to sub-pixel or not
+ * @return  Points in the boundary of the region for each angle
+ */
+static CrossPoints
+evalAreaByPolar(const SpanIndex &index, const cv::Point2d &gp, double degreeStep, bool isSubpixel)
+{
+  static const unsigned char THRESHOLD = 128;
+  static const double        HALF      = 127.5;
+
+  int nRays = countRays(degreeStep);
+  double maxRadius = 0.0;
+  REP_I (i, 4) {
+    cv::Point2d corner((i & 1) ? index.width - 1 : 0, (i & 2) ? index.height - 1 : 0);
+    maxRadius = std::max(maxRadius, calcDistance(gp, corner));
+  }
+  int nRadii = static_cast<int>(std::ceil(maxRadius)) + 1;
+
+  cv::Mat mask;
+  spanIndexToMask(index, mask);
+  cv::Mat polar(nRays, nRadii, CV_8UC1);
+  CvMat srcMat = mask;
+  CvMat dstMat = polar;
+  cvLinearPolar(&srcMat, &dstMat, cvPoint2D32f(gp.x, gp.y), maxRadius, CV_INTER_LINEAR + CV_WARP_FILL_OUTLIERS);
+
+  CrossPoints crossPoints;
+  crossPoints.xs.resize(static_cast<size_t>(nRays));
+  crossPoints.ys.resize(static_cast<size_t>(nRays));
+  #pragma omp parallel for
+  REP_I (i, nRays) {
+    const unsigned char *row = polar.ptr<unsigned char>(i);
+    int j = 0;
+    while (j < nRadii && row[j] >= THRESHOLD) {
+      j++;
+    }
+    double column = j;
+    if (isSubpixel && 0 < j && j < nRadii) {
+      column = j - 1 + (row[j - 1] - HALF) / (row[j - 1] - row[j]);
+    }
+    double radius = column * maxRadius / nRadii;
+    double theta = 2.0 * M_PI * i / nRays;
+    crossPoints.xs[static_cast<size_t>(i)] = gp.x + radius * std::cos(theta);
+    crossPoints.ys[static_cast<size_t>(i)] = gp.y + radius * std::sin(theta);
+  }
+  return crossPoints;
+}
+
+
+/*!
+ * @brief Count the number of rays which are cast by the specified step
+ * @param [in] degreeStep  Angular step of the rays in degree
+ * @return  The number of rays in [0, 360)
+ */
+ATTR_PURE ATTR_NOTHROW static int
+countRays(double degreeStep) noexcept
+{
+  static const double EPS = 1.0e-9;
+  return static_cast<int>(std::ceil(360.0 / degreeStep - EPS));
+}
+
+
+/*!
+ * @brief Plot points of metrics on the image
+ * @param [in,out] image        A filled image or an overlay to plot on
+ * @param [in]     crossPoints  Points in the boundary of the region
+ * @param [in]     plotColor    A color for plotting
+ * @param [in]     origin       Position of the top-left corner of image in the filled image
+ */
+ATTR_NOTHROW static void
+plotCrossPoints(cv::Mat &image, const CrossPoints &crossPoints, int plotColor, const cv::Point &origin) noexcept
+{
+  cv::Scalar color = toPlotScalar(plotColor);
+  REP (i, crossPoints.xs.size()) {
+    cv::Point p(static_cast<int>(round(crossPoints.xs[i])), static_cast<int>(round(crossPoints.ys[i])));
+    cv::circle(image, cv::Point(p.x - origin.x, p.y - origin.y), 1, color, -1, CV_AA);
+  }
+}
+
+
+/*!
+ * @brief Plot the points in the boundary and the center of gravity of each
+ *        region on the image
+ * @param [in,out] image    A filled image or an overlay to plot on
+ * @param [in]     results  Results of the regions
+ * @param [in]     param    Parameters of this program
+ * @param [in]     origin   Position of the top-left corner of image in the filled image
+ */
+ATTR_NOTHROW static void
+plotRegions(cv::Mat &image, const std::vector<RegionResult> &results, const Param &param, const cv::Point &origin) noexcept
+{
+  cv::Scalar color = toPlotScalar(param.gPointColor);
+  FOREACH (result, results) {
+    plotCrossPoints(image, result->crossPoints, param.plotColor, origin);
+    cv::Point gp(static_cast<int>(round(result->features.centroidX)), static_cast<int>(round(result->features.centroidY)));
+    cv::circle(image, cv::Point(gp.x - origin.x, gp.y - origin.y), 1, color, -1, CV_AA);
+  }
+}
+
+
+/*!
+ * @brief Calculate the bounding box of the plotted points, including the
+ *        radius of the circles
+ * @param [in] results  Results of the regions
+ * @param [in] image    The filled image
+ * @return  The bounding box in the filled image (1x1 at the origin if there are no points)
+ */
+ATTR_NOTHROW static cv::Rect
+calcPlotRect(const std::vector<RegionResult> &results, const cv::Mat &image) noexcept
+{
+  static const int MARGIN = 2;
+
+  int minX = image.cols;
+  int minY = image.rows;
+  int maxX = -1;
+  int maxY = -1;
+  FOREACH (result, results) {
+    const CrossPoints &crossPoints = result->crossPoints;
+    REP (i, crossPoints.xs.size() + 1) {
+      double x = i < crossPoints.xs.size() ? crossPoints.xs[i] : result->features.centroidX;
+      double y = i < crossPoints.xs.size() ? crossPoints.ys[i] : result->features.centroidY;
+      minX = std::min(minX, static_cast<int>(round(x)));
+      minY = std::min(minY, static_cast<int>(round(y)));
+      maxX = std::max(maxX, static_cast<int>(round(x)));
+      maxY = std::max(maxY, static_cast<int>(round(y)));
+    }
+  }
+  cv::Rect rect = cv::Rect(minX - MARGIN, minY - MARGIN, maxX - minX + 2 * MARGIN + 1, maxY - minY + 2 * MARGIN + 1)
+    & cv::Rect(0, 0, image.cols, image.rows);
+  return rect.area() > 0 ? rect : cv::Rect(0, 0, 1, 1);
+}
+
+
+/*!
+ * @brief Write the plotted points and the centers of gravity as svg
+ *
+ * The coordinates are not rounded, and the center of a pixel is at
+ * (x + 0.5, y + 0.5) in the svg so that the svg can be overlaid on the
+ * filled image.
+ * @param [in] filename  A name of svg-file
+ * @param [in] results   Results of the regions
+ * @param [in] image     The filled image
+ * @param [in] param     Parameters of this program
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+writePlotSvg(const std::string &filename, const std::vector<RegionResult> &results, const cv::Mat &image, const Param &param)
+{
+  std::FILE *fp = std::fopen(filename.c_str(), "w");
+  if (fp == nullptr) {
+    return false;
+  }
+  std::fprintf(fp,
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n",
+      image.cols, image.rows, image.cols, image.rows);
+  std::fprintf(fp, "<g fill=\"#%06x\">\n", param.plotColor & 0x00ffffff);
+  FOREACH (result, results) {
+    REP (i, result->crossPoints.xs.size()) {
+      std::fprintf(fp, "<circle cx=\"%.2f\" cy=\"%.2f\" r=\"1\"/>\n", result->crossPoints.xs[i] + 0.5, result->crossPoints.ys[i] + 0.5);
+    }
+  }
+  std::fprintf(fp, "</g>\n<g fill=\"#%06x\">\n", param.gPointColor & 0x00ffffff);
+  FOREACH (result, results) {
+    std::fprintf(fp, "<circle cx=\"%.2f\" cy=\"%.2f\" r=\"1\"/>\n", result->features.centroidX + 0.5, result->features.centroidY + 0.5);
+  }
+  std::fprintf(fp, "</g>\n</svg>\n");
+  return std::fclose(fp) == 0;
+}
+
+
+/*!
+ * @brief Make the name of the plot file
+ *
+ * If -p is not specified, "-plotted" is added to the name of the input
+ * image.  The suffix is ".png" for overlay, because it needs alpha channel,
+ * and ".svg" for svg.
+ * @param [in] param  Parameters of this program
+ * @return  A name of the plot file
+ */
+static std::string
+makePlotFilename(const Param &param)
+{
+  if (param.plotFilename != nullptr) {
+    return std::string(param.plotFilename);
+  }
+  switch (param.plotFormat) {
+    case PLOT_FORMAT_OVERLAY:
+      return removeSuffix(param.srcFilename) + "-plotted.png";
+    case PLOT_FORMAT_SVG:
+      return removeSuffix(param.srcFilename) + "-plotted.svg";
+    case PLOT_FORMAT_IMAGE:
+    default:
+      return removeSuffix(param.srcFilename) + "-plotted." + getSuffix(param.srcFilename);
+  }
+}
+
+
+/*!
+ * @brief Convert the color into the scalar of OpenCV, whose alpha is opaque
+ * @param [in] color  A color (0xRRGGBB)
+ * @return  The scalar in BGRA order
+ */
+ATTR_NOTHROW static cv::Scalar
+toPlotScalar(int color) noexcept
+{
+  return cv::Scalar(
+      (color & B_MASK),
+      (color & G_MASK) >> 8,
+      (color & R_MASK) >> 16,
+      255);
+}
+
+
+/*!
+ * @brief Calculates the distance to the position where the boundary of the
+ *        region from the center of gravity
+ *
+ * The distances and their summary are computed in one pass over the
+ * structure of arrays of the points, two points at a time with SSE2 if it is
+ * available.  The area and the perimeter for the circularity are those of
+ * the polygon which connects the points in order of the angle.
+ * @param [in]  gp           Center of gravity point
+ * @param [in]  crossPoints  Points in the boundary of the region
+ * @param [out] summary      Summary of the distances
+ * @return The distance to the position where the boundary of the region from
+ *         the center of gravity
+ */
+ATTR_NOTHROW static std::vector<double>
+calcResults(const cv::Point2d &gp, const CrossPoints &crossPoints, RadiusSummary &summary) noexcept
+{
+  size_t nPoints = crossPoints.xs.size();
+  std::vector<double> distances(nPoints);
+  std::memset(&summary, 0, sizeof(summary));
+  if (nPoints == 0) {
+    return distances;
+  }
+  const double *restrict xs = &crossPoints.xs[0];
+  const double *restrict ys = &crossPoints.ys[0];
+  double *restrict ds = &distances[0];
+
+  double minRadius = HUGE_VAL;
+  double maxRadius = 0.0;
+  double sum       = 0.0;
+  double sumSq     = 0.0;
+  double area2     = 0.0;
+  double perimeter = 0.0;
+  size_t i = 0;
+#ifdef USE_SSE2
+  // The next point of the i-th point is i + 1, except for the last point
+  if (nPoints > 2) {
+    __m128d gx       = _mm_set1_pd(gp.x);
+    __m128d gy       = _mm_set1_pd(gp.y);
+    __m128d vMin     = _mm_set1_pd(HUGE_VAL);
+    __m128d vMax     = _mm_setzero_pd();
+    __m128d vSum     = _mm_setzero_pd();
+    __m128d vSumSq   = _mm_setzero_pd();
+    __m128d vArea2   = _mm_setzero_pd();
+    __m128d vPerim   = _mm_setzero_pd();
+    for (; i + 2 < nPoints; i += 2) {
+      __m128d dx  = _mm_sub_pd(_mm_loadu_pd(&xs[i]), gx);
+      __m128d dy  = _mm_sub_pd(_mm_loadu_pd(&ys[i]), gy);
+      __m128d ndx = _mm_sub_pd(_mm_loadu_pd(&xs[i + 1]), gx);
+      __m128d ndy = _mm_sub_pd(_mm_loadu_pd(&ys[i + 1]), gy);
+      __m128d d   = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+      _mm_storeu_pd(&ds[i], d);
+      vMin   = _mm_min_pd(vMin, d);
+      vMax   = _mm_max_pd(vMax, d);
+      vSum   = _mm_add_pd(vSum, d);
+      vSumSq = _mm_add_pd(vSumSq, _mm_mul_pd(d, d));
+      vArea2 = _mm_add_pd(vArea2, _mm_sub_pd(_mm_mul_pd(dx, ndy), _mm_mul_pd(ndx, dy)));
+      __m128d ex = _mm_sub_pd(ndx, dx);
+      __m128d ey = _mm_sub_pd(ndy, dy);
+      vPerim = _mm_add_pd(vPerim, _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey))));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, vMin);
+    minRadius = std::min(lanes[0], lanes[1]);
+    _mm_storeu_pd(lanes, vMax);
+    maxRadius = std::max(lanes[0], lanes[1]);
+    _mm_storeu_pd(lanes, vSum);
+    sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, vSumSq);
+    sumSq = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, vArea2);
+    area2 = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, vPerim);
+    perimeter = lanes[0] + lanes[1];
+  }
+#endif
+  for (; i < nPoints; i++) {
+    size_t next = i + 1 == nPoints ? 0 : i + 1;
+    double dx  = xs[i] - gp.x;
+    double dy  = ys[i] - gp.y;
+    double ndx = xs[next] - gp.x;
+    double ndy = ys[next] - gp.y;
+    double d   = std::sqrt(dx * dx + dy * dy);
+    ds[i] = d;
+    minRadius  = std::min(minRadius, d);
+    maxRadius  = std::max(maxRadius, d);
+    sum       += d;
+    sumSq     += d * d;
+    area2     += dx * ndy - ndx * dy;
+    perimeter += std::sqrt((ndx - dx) * (ndx - dx) + (ndy - dy) * (ndy - dy));
+  }
+
+  double mean = sum / static_cast<double>(nPoints);
+  summary.minRadius   = minRadius;
+  summary.maxRadius   = maxRadius;
+  summary.meanRadius  = mean;
+  summary.stdRadius   = std::sqrt(std::max(sumSq / static_cast<double>(nPoints) - mean * mean, 0.0));
+  summary.radiusRatio = maxRadius > 0.0 ? minRadius / maxRadius : 0.0;
+  summary.circularity = perimeter > 0.0 ? 2.0 * M_PI * std::fabs(area2) / (perimeter * perimeter) : 0.0;
+  return distances;
+}
+
+
+/*!
+ * @brief Calculate the mean and the standard deviation of the distances
+ *
+ * This is used for the distances of the adaptive sampling which are
+ * resampled to the uniform step, so that each angle has the same weight.
+ * The other members of the summary are not changed.
+ * @param [in]     distances  The distances for each angle of the uniform step
+ * @param [in,out] summary    Summary of the distances
+ */
+ATTR_NOTHROW static void
+calcRadiusStats(const std::vector<double> &distances, RadiusSummary &summary) noexcept
+{
+  if (distances.empty()) {
+    return;
+  }
+  double sum   = 0.0;
+  double sumSq = 0.0;
+  FOREACH (d, distances) {
+    sum   += *d;
+    sumSq += *d * *d;
+  }
+  double mean = sum / static_cast<double>(distances.size());
+  summary.meanRadius = mean;
+  summary.stdRadius  = std::sqrt(std::max(sumSq / static_cast<double>(distances.size()) - mean * mean, 0.0));
+}
+
+
+/*!
+ * @brief Print the summary of the distances to stdout
+ * @param [in] summary  Summary of the distances
+ */
+static void
+printSummary(const RadiusSummary &summary)
+{
+  std::printf("radius = (%f, %f)\nradiusMean = %f\nradiusStd = %f\nradiusRatio = %f\ncircularity = %f\n",
+      summary.minRadius, summary.maxRadius, summary.meanRadius, summary.stdRadius,
+      summary.radiusRatio, summary.circularity);
+}
+
+
+/*!
+ * @brief Calculate Fourier descriptor of the distances for each angle
+ *
+ * The distances are transformed with cv::dft(), and the magnitudes of the
+ * 1st to K-th coefficients are divided by the magnitude of the DC component.
+ * Rotation of the region is a cyclic shift of the distances, which changes
+ * only the phases, and scaling of the region scales all the coefficients,
+ * so that the descriptor is invariant to both of them.
+ * The coefficients beyond the Nyquist frequency are zero.
+ * @param [in] distances      The distances for each angle
+ * @param [in] nCoefficients  The number of coefficients K
+ * @return  Fourier descriptor (K elements)
+ */
+static std::vector<double>
+calcFourierDescriptor(const std::vector<double> &distances, int nCoefficients)
+{
+  std::vector<double> descriptor(static_cast<size_t>(nCoefficients), 0.0);
+  int nPoints = static_cast<int>(distances.size());
+  if (nCoefficients == 0 || nPoints == 0) {
+    return descriptor;
+  }
+  cv::Mat profile(1, nPoints, CV_64FC1);
+  std::copy(distances.begin(), distances.end(), profile.ptr<double>(0));
+  cv::Mat spectrum;
+  cv::dft(profile, spectrum, cv::DFT_COMPLEX_OUTPUT);
+
+  const double *coefficients = spectrum.ptr<double>(0);
+  double dc = std::fabs(coefficients[0]);
+  if (dc <= 0.0) {
+    return descriptor;
+  }
+  int nValid = std::min(nCoefficients, nPoints / 2);
+  FOR (k, 1, nValid + 1) {
+    descriptor[static_cast<size_t>(k - 1)] = std::sqrt(coefficients[2 * k] * coefficients[2 * k] + coefficients[2 * k + 1] * coefficients[2 * k + 1]) / dc;
+  }
+  return descriptor;
+}
+
+
+/*!
+ * @brief Evaluate the region, or each connected component of it
+ *
+ * If --regions is specified, the spans are labeled, the components smaller
+ * than the minimum area are dropped before the profile is calculated, and
+ * the remaining components are evaluated in parallel.  Otherwise the whole
+ * region is evaluated as one region.
+ * @param [in]  index    Run-length representation of the filled region
+ * @param [in]  param    Parameters of this program
+ * @param [out] results  Results of the regions in raster order
+ */
+static void
+evalRegions(const SpanIndex &index, const Param &param, std::vector<RegionResult> &results)
+{
+  if (!param.isRegions) {
+    results.assign(1, RegionResult());
+    evalRegion(index, param, results[0]);
+    return;
+  }
+  std::vector<int> labels;
+  int nLabels = labelSpans(index, labels);
+  std::vector<long long> areas(static_cast<size_t>(nLabels), 0);
+  REP (k, index.spans.size()) {
+    areas[static_cast<size_t>(labels[k])] += index.spans[k].end - index.spans[k].begin;
+  }
+  std::vector<int> componentIds(static_cast<size_t>(nLabels), -1);
+  int nComponents = 0;
+  REP (i, areas.size()) {
+    if (areas[i] >= param.minArea) {
+      componentIds[i] = nComponents++;
+    }
+  }
+  std::vector<SpanIndex> components;
+  extractComponents(index, labels, componentIds, nComponents, components);
+
+  // Each component is evaluated by a thread, unless there is only one
+  results.assign(static_cast<size_t>(nComponents), RegionResult());
+  #pragma omp parallel for schedule(dynamic, 1) if (nComponents > 1)
+  REP_I (i, nComponents) {
+    evalRegion(components[static_cast<size_t>(i)], param, results[static_cast<size_t>(i)]);
+  }
+}
+
+
+/*!
+ * @brief Calculate the moments, the profile and its summary of a region
+ * @param [in]  index   Run-length representation of the region
+ * @param [in]  param   Parameters of this program
+ * @param [out] result  Result of the region
+ */
+static void
+evalRegion(const SpanIndex &index, const Param &param, RegionResult &result)
+{
+  result.moments  = param.momentMethod == MOMENT_METHOD_CONTOUR ? calcMomentByContour(index) : calcMoment(index);
+  result.features = calcShapeFeatures(result.moments);
+  cv::Point2d gp(result.features.centroidX, result.features.centroidY);
+  if (param.adaptiveThreshold > 0.0 && param.method == EVAL_METHOD_RAY) {
+    // The summary and the descriptor which assume the uniform step are taken from the resampled distances
+    SpanIndex columns;
+    transposeSpanIndex(index, columns);
+    result.crossPoints = evalAreaAdaptive(index, columns, gp, param.degreeStep, param.adaptiveThreshold, param.isSubpixel, result.angles);
+    result.distances   = calcResults(gp, result.crossPoints, result.summary);
+    std::vector<double> resampled = resampleProfile(result.angles, result.distances, param.degreeStep);
+    calcRadiusStats(resampled, result.summary);
+    result.descriptor = calcFourierDescriptor(resampled, param.nFourier);
+    return;
+  }
+  result.crossPoints = calcProfile(index, gp, param.degreeStep, param.method, param.binMode, param.isSubpixel);
+  result.distances   = calcResults(gp, result.crossPoints, result.summary);
+  result.descriptor  = calcFourierDescriptor(result.distances, param.nFourier);
+}
+
+
+/*!
+ * @brief Calculate the profiles of the region from the candidate centers
+ *
+ * The run-length representation of the columns is built once, and the rays
+ * from all centers are cast with it and the one of the rows.
+ * @param [in]  index     Run-length representation of the region
+ * @param [in]  region    Result of the region from its center of gravity
+ * @param [in]  param     Parameters of this program
+ * @param [out] profiles  Profiles from the centers in the order of CenterType
+ */
+static void
+evalCenters(const SpanIndex &index, const RegionResult &region, const Param &param, std::vector<CenterProfile> &profiles)
+{
+  SpanIndex columns;
+  transposeSpanIndex(index, columns);
+  profiles.clear();
+  REP_I (i, N_CENTER_TYPES) {
+    if ((param.centerFlags & (1 << i)) == 0) {
+      continue;
+    }
+    CenterProfile profile;
+    profile.type   = static_cast<CenterType>(i);
+    profile.center = findCenter(index, region.features, profile.type);
+    RegionResult &result = profile.result;
+    result.moments  = region.moments;
+    result.features = region.features;
+    result.crossPoints = evalArea(index, columns, profile.center, param.degreeStep, param.isSubpixel);
+    result.distances   = calcResults(profile.center, result.crossPoints, result.summary);
+    result.descriptor  = calcFourierDescriptor(result.distances, param.nFourier);
+    profiles.push_back(profile);
+  }
+}
+
+
+/*!
+ * @brief Find the candidate center of the region
+ *
+ * The center of the bounding box is the midpoint of the first and the last
+ * pixels in each axis.  The center of the inscribed circle is the pixel
+ * which is the farthest from the background, where the outside of the image
+ * is regarded as the background.  The center of gravity is returned for the
+ * empty region.
+ * @param [in] index     Run-length representation of the region
+ * @param [in] features  Shape features of the region
+ * @param [in] type      Type of the center
+ * @return  The center
+ */
+static cv::Point2d
+findCenter(const SpanIndex &index, const ShapeFeatures &features, CenterType type)
+{
+  cv::Point2d centroid(features.centroidX, features.centroidY);
+  if (index.spans.empty()) {
+    return centroid;
+  }
+  switch (type) {
+    case CENTER_TYPE_BBOX:
+      {
+        int minX = index.width;
+        int maxX = -1;
+        int minY = -1;
+        int maxY = -1;
+        REP_I (y, index.height) {
+          int kBegin = index.rowOffsets[static_cast<size_t>(y)];
+          int kEnd   = index.rowOffsets[static_cast<size_t>(y) + 1];
+          if (kBegin == kEnd) {
+            continue;
+          }
+          if (minY < 0) {
+            minY = y;
+          }
+          maxY = y;
+          minX = std::min(minX, index.spans[static_cast<size_t>(kBegin)].begin);
+          maxX = std::max(maxX, index.spans[static_cast<size_t>(kEnd - 1)].end - 1);
+        }
+        return cv::Point2d((minX + maxX) * 0.5, (minY + maxY) * 0.5);
+      }
+    case CENTER_TYPE_INSCRIBED:
+      {
+        // The mask has the margin of the background around the image
+        cv::Mat padded = cv::Mat::zeros(index.height + 2, index.width + 2, CV_8UC1);
+        REP_I (y, index.height) {
+          unsigned char *row = padded.ptr<unsigned char>(y + 1) + 1;
+          for (int k = index.rowOffsets[static_cast<size_t>(y)]; k < index.rowOffsets[static_cast<size_t>(y) + 1]; k++) {
+            const Span &span = index.spans[static_cast<size_t>(k)];
+            std::fill(row + span.begin, row + span.end, static_cast<unsigned char>(255));
+          }
+        }
+        cv::Mat dist;
+        cv::distanceTransform(padded, dist, CV_DIST_L2, CV_DIST_MASK_PRECISE);
+        cv::Point maxLoc;
+        cv::minMaxLoc(dist, nullptr, nullptr, nullptr, &maxLoc);
+        return cv::Point2d(maxLoc.x - 1, maxLoc.y - 1);
+      }
+    case CENTER_TYPE_CENTROID:
+    case N_CENTER_TYPES:
+    default:
+      return centroid;
+  }
+}
+
+
+/*!
+ * @brief Print the moments, the shape features and the summary of the
+ *        profile of a region to stdout
+ * @param [in] result  Result of the region
+ */
+static void
+printRegion(const RegionResult &result)
+{
+  const Moments &moments = result.moments;
+  const ShapeFeatures &features = result.features;
+  std::printf("moment = (%f, %f)\n", features.centroidX, features.centroidY);
+  std::printf("m00 = %.0f\nm10 = %.0f\nm01 = %.0f\nm20 = %.0f\nm11 = %.0f\nm02 = %.0f\n",
+      moments.m00, moments.m10, moments.m01, moments.m20, moments.m11, moments.m02);
+  std::printf("axes = (%f, %f)\norientation = %f\neccentricity = %f\n",
+      features.majorAxis, features.minorAxis, features.orientation, features.eccentricity);
+  printSummary(result.summary);
+  if (!result.descriptor.empty()) {
+    std::printf("fourier = (");
+    REP (i, result.descriptor.size()) {
+      std::printf(i == 0 ? "%f" : ", %f", result.descriptor[i]);
+    }
+    std::printf(")\n");
+  }
+}
+
+
+/*!
+ * @brief Make the name of the region for the output
+ * @param [in] name         A name of the image
+ * @param [in] regionIndex  Index of the region
+ * @param [in] isRegions    The regions are the connected components or not
+ * @return  "NAME#INDEX" if isRegions is true, otherwise "NAME"
+ */
+static std::string
+makeRegionName(const char *name, size_t regionIndex, bool isRegions)
+{
+  if (!isRegions) {
+    return std::string(name);
+  }
+  char buf[32];
+  std::sprintf(buf, "#%lu", static_cast<unsigned long>(regionIndex));
+  return std::string(name) + buf;
+}
+
+
+/*!
+ * @brief Append the profiles of the regions to the binary profile file
+ * @param [in,out] writer   Writer of the profile file
+ * @param [in]     name     A name of the image
+ * @param [in]     results  Results of the regions
+ * @param [in]     param    Parameters of this program
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+writeRegionProfiles(ProfileWriter &writer, const char *name, const std::vector<RegionResult> &results, const Param &param)
+{
+  REP (i, results.size()) {
+    const RegionResult &result = results[i];
+    std::string regionName = makeRegionName(name, i, param.isRegions);
+    if (!writeProfile(writer, regionName.c_str(), result, param.degreeStep)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Write the distances of the regions in csv-format
+ * @param [in] fp          File pointer of output
+ * @param [in] name        A name of the image
+ * @param [in] results     Results of the regions
+ * @param [in] param       Parameters of this program
+ * @param [in] isShowName  Write the name of each region as a comment line or not
+ */
+static void
+writeRegionCsv(std::FILE *fp, const char *name, const std::vector<RegionResult> &results, const Param &param, bool isShowName)
+{
+  REP (i, results.size()) {
+    if (isShowName) {
+      std::fprintf(fp, "# %s\n", makeRegionName(name, i, param.isRegions).c_str());
+    }
+    if (results[i].angles.empty()) {
+      writeProfileCsv(fp, results[i].distances, param.degreeStep);
+    } else {
+      writeAngleProfileCsv(fp, results[i].angles, results[i].distances, param.degreeStep);
+    }
+  }
+}
+
+
+/*!
+ * @brief Make the name of the profile from the center for the output
+ * @param [in] name        A name of the image
+ * @param [in] centerName  Name of the type of the center
+ * @return  "NAME@CENTER"
+ */
+static std::string
+makeCenterName(const char *name, const char *centerName)
+{
+  return std::string(name) + "@" + centerName;
+}
+
+
+/*!
+ * @brief Append the profiles from the centers to the binary profile file
+ * @param [in,out] writer    Writer of the profile file
+ * @param [in]     name      A name of the image
+ * @param [in]     profiles  Profiles from the centers
+ * @param [in]     param     Parameters of this program
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+writeCenterProfiles(ProfileWriter &writer, const char *name, const std::vector<CenterProfile> &profiles, const Param &param)
+{
+  REP (i, profiles.size()) {
+    const RegionResult &result = profiles[i].result;
+    std::string centerName = makeCenterName(name, CENTER_TYPE_NAMES[profiles[i].type]);
+    if (!writeProfile(writer, centerName.c_str(), result, param.degreeStep)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Write the distances from the centers in csv-format
+ *
+ * Each profile is preceded by its name as a comment line.
+ * @param [in] fp        File pointer of output
+ * @param [in] name      A name of the image
+ * @param [in] profiles  Profiles from the centers
+ * @param [in] param     Parameters of this program
+ */
+static void
+writeCenterCsv(std::FILE *fp, const char *name, const std::vector<CenterProfile> &profiles, const Param &param)
+{
+  REP (i, profiles.size()) {
+    std::fprintf(fp, "# %s\n", makeCenterName(name, CENTER_TYPE_NAMES[profiles[i].type]).c_str());
+    writeProfileCsv(fp, profiles[i].result.distances, param.degreeStep);
+  }
+}
+
+
+/*!
+ * @brief Make the moments and the shape features of the region in the order
+ *        of the scalars of the profile
+ * @param [in] result  Result of the region
+ * @return  The scalars from PROFILE_SCALAR_AREA to PROFILE_SCALAR_ECCENTRICITY
+ */
+static std::vector<double>
+makeFeatureScalars(const RegionResult &result)
+{
+  const ShapeFeatures &features = result.features;
+  const double values[] = {
+    result.moments.m00, features.centroidX, features.centroidY,
+    features.majorAxis, features.minorAxis, features.orientation, features.eccentricity
+  };
+  return std::vector<double>(values, values + LENGTH(values));
+}
+
+
+/*!
+ * @brief Append the profile to the binary profile file
+ *
+ * The scalars are the summary of the distances, the moments and the shape
+ * features, and the Fourier descriptor.
+ * @param [in,out] writer      Writer of the profile file
+ * @param [in]     name        Name of the record
+ * @param [in]     result      Result of the region, whose angles are empty for the uniform step
+ * @param [in]     degreeStep  Angular step in degree
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+writeProfile(ProfileWriter &writer, const char *name, const RegionResult &result, double degreeStep)
+{
+  const CrossPoints &crossPoints = result.crossPoints;
+  const std::vector<double> &angles = result.angles;
+  const std::vector<double> &scores = result.distances;
+  const RadiusSummary &summary = result.summary;
+  size_t nPoints = scores.size();
+  std::vector<double> uniformAngles;
+  if (angles.empty()) {
+    uniformAngles.resize(nPoints);
+    REP (i, nPoints) {
+      uniformAngles[i] = static_cast<double>(i) * degreeStep;
+    }
+  }
+  const std::vector<double> &pointAngles = angles.empty() ? uniformAngles : angles;
+  const double *columns[PROFILE_N_COLUMNS];
+  columns[PROFILE_COLUMN_ANGLE]    = nPoints == 0 ? nullptr : &pointAngles[0];
+  columns[PROFILE_COLUMN_DISTANCE] = nPoints == 0 ? nullptr : &scores[0];
+  columns[PROFILE_COLUMN_X]        = nPoints == 0 ? nullptr : &crossPoints.xs[0];
+  columns[PROFILE_COLUMN_Y]        = nPoints == 0 ? nullptr : &crossPoints.ys[0];
+  std::vector<double> scalars(PROFILE_FEATURE_BEGIN);
+  scalars[PROFILE_SCALAR_MIN_RADIUS]   = summary.minRadius;
+  scalars[PROFILE_SCALAR_MAX_RADIUS]   = summary.maxRadius;
+  scalars[PROFILE_SCALAR_MEAN_RADIUS]  = summary.meanRadius;
+  scalars[PROFILE_SCALAR_STD_RADIUS]   = summary.stdRadius;
+  scalars[PROFILE_SCALAR_RADIUS_RATIO] = summary.radiusRatio;
+  scalars[PROFILE_SCALAR_CIRCULARITY]  = summary.circularity;
+  std::vector<double> features = makeFeatureScalars(result);
+  scalars.insert(scalars.end(), features.begin(), features.end());
+  scalars.insert(scalars.end(), result.descriptor.begin(), result.descriptor.end());
+  return writeProfileRecord(writer, name, columns, PROFILE_N_COLUMNS, nPoints, &scalars[0], scalars.size());
+}
+
+
+/*!
+ * @brief Calculate the seed of the hash of the image file for the key of the
+ *        result cache
+ *
+ * The seed is the hash of the parameters which affect the results, so that
+ * the results with different parameters have different keys.
+ * @param [in] param  Parameters of this program
+ * @return  The seed
+ */
+static unsigned long long
+calcCacheSeed(const Param &param)
+{
+  static const double FORMAT_VERSION = 2.0;
+
+  const double values[] = {
+    FORMAT_VERSION,
+    static_cast<double>(param.foregroundColor),
+    param.tolerance,
+    static_cast<double>(param.metric),
+    param.degreeStep,
+    static_cast<double>(param.method),
+    static_cast<double>(param.momentMethod),
+    static_cast<double>(param.binMode),
+    param.isSubpixel ? 1.0 : 0.0,
+    static_cast<double>(param.fillMode),
+    static_cast<double>(param.trimBlank),
+    static_cast<double>(param.nFourier),
+    param.isRegions ? 1.0 : 0.0,
+    static_cast<double>(param.minArea),
+    param.adaptiveThreshold
+  };
+  unsigned char buf[8 * LENGTH(values)];
+  REP (i, LENGTH(values)) {
+    putLeDouble(&buf[8 * i], values[i]);
+  }
+  return calcXxHash64(buf, sizeof(buf), 0);
+}
+
+
+/*!
+ * @brief Serialize the results of the regions for the result cache
+ *
+ * The data is a sequence of little-endian float64: the number of regions,
+ * and for each region, the moments, the number of points, the x-positions,
+ * the y-positions, the distances, the summary, the number of Fourier
+ * coefficients, the coefficients, the number of angles and the angles of
+ * the adaptive sampling.  The shape features are not stored because they are
+ * calculated from the moments.
+ * @param [in]  results  Results of the regions
+ * @param [out] data     The serialized data
+ */
+static void
+serializeRegions(const std::vector<RegionResult> &results, std::vector<unsigned char> &data)
+{
+  std::vector<double> values;
+  values.push_back(static_cast<double>(results.size()));
+  FOREACH (result, results) {
+    const Moments &moments = result->moments;
+    const RadiusSummary &summary = result->summary;
+    const double header[] = {moments.m00, moments.m10, moments.m01, moments.m20, moments.m11, moments.m02};
+    const double footer[] = {
+      summary.minRadius, summary.maxRadius, summary.meanRadius,
+      summary.stdRadius, summary.radiusRatio, summary.circularity
+    };
+    values.insert(values.end(), header, header + LENGTH(header));
+    values.push_back(static_cast<double>(result->distances.size()));
+    values.insert(values.end(), result->crossPoints.xs.begin(), result->crossPoints.xs.end());
+    values.insert(values.end(), result->crossPoints.ys.begin(), result->crossPoints.ys.end());
+    values.insert(values.end(), result->distances.begin(), result->distances.end());
+    values.insert(values.end(), footer, footer + LENGTH(footer));
+    values.push_back(static_cast<double>(result->descriptor.size()));
+    values.insert(values.end(), result->descriptor.begin(), result->descriptor.end());
+    values.push_back(static_cast<double>(result->angles.size()));
+    values.insert(values.end(), result->angles.begin(), result->angles.end());
+  }
+  data.resize(8 * values.size());
+  REP (i, values.size()) {
+    putLeDouble(&data[8 * i], values[i]);
+  }
+}
+
+
+/*!
+ * @brief Deserialize the results of the regions from the result cache
+ * @param [in]  data     The serialized data, which serializeRegions() gives
+ * @param [out] results  Results of the regions
+ * @return  true if the data is valid, otherwise false
+ */
+static bool
+deserializeRegions(const std::vector<unsigned char> &data, std::vector<RegionResult> &results)
+{
+  if (data.size() % 8 != 0 || data.empty()) {
+    return false;
+  }
+  size_t nValues = data.size() / 8;
+  size_t pos = 0;
+  size_t nRegions = static_cast<size_t>(getLeDouble(&data[pos++ * 8]));
+  if (nRegions > nValues) {
+    return false;
+  }
+  results.assign(nRegions, RegionResult());
+  FOREACH (result, results) {
+    if (pos + 7 > nValues) {
+      return false;
+    }
+    Moments &moments = result->moments;
+    moments.m00 = getLeDouble(&data[pos++ * 8]);
+    moments.m10 = getLeDouble(&data[pos++ * 8]);
+    moments.m01 = getLeDouble(&data[pos++ * 8]);
+    moments.m20 = getLeDouble(&data[pos++ * 8]);
+    moments.m11 = getLeDouble(&data[pos++ * 8]);
+    moments.m02 = getLeDouble(&data[pos++ * 8]);
+    result->features = calcShapeFeatures(moments);
+    size_t nPoints = static_cast<size_t>(getLeDouble(&data[pos++ * 8]));
+    if (nPoints > nValues || pos + 3 * nPoints + 7 > nValues) {
+      return false;
+    }
+    std::vector<double> *columns[] = {&result->crossPoints.xs, &result->crossPoints.ys, &result->distances};
+    REP (j, LENGTH(columns)) {
+      columns[j]->resize(nPoints);
+      REP (k, nPoints) {
+        (*columns[j])[k] = getLeDouble(&data[pos++ * 8]);
+      }
+    }
+    RadiusSummary &summary = result->summary;
+    summary.minRadius   = getLeDouble(&data[pos++ * 8]);
+    summary.maxRadius   = getLeDouble(&data[pos++ * 8]);
+    summary.meanRadius  = getLeDouble(&data[pos++ * 8]);
+    summary.stdRadius   = getLeDouble(&data[pos++ * 8]);
+    summary.radiusRatio = getLeDouble(&data[pos++ * 8]);
+    summary.circularity = getLeDouble(&data[pos++ * 8]);
+    size_t nCoefficients = static_cast<size_t>(getLeDouble(&data[pos++ * 8]));
+    if (nCoefficients > nValues - pos) {
+      return false;
+    }
+    result->descriptor.resize(nCoefficients);
+    REP (j, nCoefficients) {
+      result->descriptor[j] = getLeDouble(&data[pos++ * 8]);
+    }
+    if (pos >= nValues) {
+      return false;
+    }
+    size_t nAngles = static_cast<size_t>(getLeDouble(&data[pos++ * 8]));
+    if ((nAngles != 0 && nAngles != nPoints) || nAngles > nValues - pos) {
+      return false;
+    }
+    result->angles.resize(nAngles);
+    REP (j, nAngles) {
+      result->angles[j] = getLeDouble(&data[pos++ * 8]);
+    }
+  }
+  return pos == nValues;
+}
+
+
+/*!
+ * @brief Evaluate all images in the directory or the manifest file
+ *
+ * The images are sorted in descending order of the file size and assigned to
+ * the threads one by one dynamically, so that large images don't remain at
+ * the end.  Each thread reuses its own run-length representation as the
+ * scratch buffer.  The results are written into one output in order of
+ * completion: appended to the profile file if --profile-file is specified,
+ * otherwise written in csv-format with a comment line of the image name.
+ * Each image is filled and trimmed as specified by --fill and --trim, but
+ * plotting, showing and writing images are not done.
+ * If --cache is specified, each image file is mapped into memory and hashed
+ * with the parameters.  The results of the cached images are read from the
+ * cache without decoding the images, and the others are decoded from the
+ * mapped file and stored into the cache after evaluation.
+ * @param [in] param    Parameters of this program
+ * @param [in] matcher  Classifier of the color of filled region
+ * @return  exit-status
+ */
+static int
+evalBatch(const Param &param, const ColorMatcher &matcher)
+{
+  std::vector<std::string> filenames;
+  if (!listImageFiles(param.batchFilename, filenames)) {
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::pair<long long, size_t> > order;
+  REP (i, filenames.size()) {
+    order.push_back(std::make_pair(-getFileSize(filenames[i].c_str()), i));
+  }
+  std::sort(order.begin(), order.end());
+
+  ProfileWriter writer;
+  std::FILE *fp = stdout;
+  if (param.profileFilename != nullptr) {
+    if (!openProfileWriter(writer, param.profileFilename)) {
+      std::cerr << "Failed to open profile file: " << param.profileFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else if (param.dstFilename != nullptr) {
+    fp = std::fopen(param.dstFilename, "w");
+    if (fp == nullptr) {
+      std::cerr << "Failed to open file: " << param.dstFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  ResultCache cache;
+  unsigned long long cacheSeed = 0;
+  if (param.cacheDirname != nullptr) {
+    if (!openResultCache(cache, param.cacheDirname, static_cast<unsigned long long>(param.cacheSize) << 20)) {
+      std::cerr << "Failed to open cache directory: " << param.cacheDirname << std::endl;
+      return EXIT_FAILURE;
+    }
+    cacheSeed = calcCacheSeed(param);
+  }
+
+#ifdef _OPENMP
+  int nThreads = omp_get_max_threads();
+#else
+  int nThreads = 1;
+#endif
+  std::vector<SpanIndex> scratches(static_cast<size_t>(nThreads));
+  int nImages = static_cast<int>(order.size());
+  int nFailures = 0;
+  long long t0 = cv::getTickCount();
+  #pragma omp parallel for schedule(dynamic, 1) reduction(+:nFailures)
+  REP_I (i, nImages) {
+#ifdef _OPENMP
+    SpanIndex &index = scratches[static_cast<size_t>(omp_get_thread_num())];
+#else
+    SpanIndex &index = scratches[0];
+#endif
+    const std::string &filename = filenames[order[static_cast<size_t>(i)].second];
+    std::vector<RegionResult> results;
+    unsigned long long key = 0;
+    bool isCached = false;
+    cv::Mat srcImage;
+    if (param.cacheDirname == nullptr) {
+      try {
+        srcImage = cv::imread(filename);
+      } catch (const cv::Exception &) {
+        srcImage = cv::Mat();
+      }
+    } else {
+      MappedFile file;
+      if (openMappedFile(file, filename.c_str()) && file.data != nullptr) {
+        key = calcXxHash64(file.data, file.size, cacheSeed);
+        std::vector<unsigned char> data;
+        #pragma omp critical(resultCache)
+        isCached = lookupResultCache(cache, key, data);
+        isCached = isCached && deserializeRegions(data, results);
+        if (!isCached) {
+          try {
+            srcImage = cv::imdecode(cv::Mat(1, static_cast<int>(file.size), CV_8UC1, const_cast<unsigned char *>(file.data)), CV_LOAD_IMAGE_COLOR);
+          } catch (const cv::Exception &) {
+            srcImage = cv::Mat();
+          }
+        }
+      }
+      closeMappedFile(file);
+    }
+    if (!isCached && srcImage.data == nullptr) {
+      #pragma omp critical(batchOutput)
+      std::cerr << "Failed to read image file: " << filename << std::endl;
+      nFailures++;
+      continue;
+    }
+    if (!isCached) {
+      buildSpanIndex(index, fillImage(srcImage, matcher, param.fillMode, param.trimBlank), matcher);
+      evalRegions(index, param, results);
+      if (param.cacheDirname != nullptr) {
+        std::vector<unsigned char> data;
+        serializeRegions(results, data);
+        bool isStored;
+        #pragma omp critical(resultCache)
+        isStored = storeResultCache(cache, key, data);
+        if (!isStored) {
+          #pragma omp critical(batchOutput)
+          std::cerr << "Failed to write cache: " << filename << std::endl;
+        }
+      }
+    }
+    #pragma omp critical(batchOutput)
+    {
+      if (param.profileFilename != nullptr) {
+        if (!writeRegionProfiles(writer, filename.c_str(), results, param)) {
+          std::cerr << "Failed to write profile file: " << param.profileFilename << std::endl;
+          nFailures++;
+        }
+      } else {
+        writeRegionCsv(fp, filename.c_str(), results, param, true);
+      }
+    }
+  }
+  double elapsed = static_cast<double>(cv::getTickCount() - t0) / cv::getTickFrequency();
+
+  if (param.profileFilename != nullptr) {
+    closeProfileWriter(writer);
+  } else if (fp != stdout) {
+    std::fclose(fp);
+  }
+  std::fprintf(stderr, "%d images (%d failed) in %f s with %d threads: %f images/s\n",
+      nImages, nFailures, elapsed, nThreads, elapsed > 0.0 ? nImages / elapsed : 0.0);
+  if (param.cacheDirname != nullptr) {
+    if (!closeResultCache(cache)) {
+      std::cerr << "Failed to write cache index: " << param.cacheDirname << std::endl;
+      nFailures++;
+    }
+    std::fprintf(stderr, "cache: %llu hits, %llu misses, %llu evictions, %llu entries (%llu bytes)\n",
+        cache.nHits, cache.nMisses, cache.nEvictions,
+        static_cast<unsigned long long>(cache.entries.size()), cache.totalSize);
+  }
+  return nFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*!
+ * @brief List the image files in the directory or the manifest file
+ *
+ * The image files in the directory are sorted by name, and the files in the
+ * manifest file are in order of the lines.
+ * @param [in]  listname   A name of the directory or the manifest file
+ * @param [out] filenames  Names of the image files
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+listImageFiles(const char *listname, std::vector<std::string> &filenames)
+{
+  filenames.clear();
+  if (isDirectory(listname)) {
+    std::vector<std::string> allFilenames;
+    if (!listDirectory(listname, allFilenames)) {
+      std::cerr << "Failed to list directory: " << listname << std::endl;
+      return false;
+    }
+    FOREACH (filename, allFilenames) {
+      if (isImageFilename(*filename)) {
+        filenames.push_back(*filename);
+      }
+    }
+  } else if (!readManifest(listname, filenames)) {
+    std::cerr << "Failed to read manifest file: " << listname << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Evaluate the frames in the directory or the manifest file in order
+ *
+ * The frames of a time-series capture are evaluated one by one, and the
+ * results are written in the same format as --batch.  With the ray method,
+ * the span method of moment and without --regions, each frame is evaluated
+ * incrementally from the previous frame by evalFrame().  Otherwise each frame
+ * is evaluated from scratch.
+ * @param [in] param    Parameters of this program
+ * @param [in] matcher  Classifier of the color of filled region
+ * @return  exit-status
+ */
+static int
+evalSequence(const Param &param, const ColorMatcher &matcher)
+{
+  std::vector<std::string> filenames;
+  if (!listImageFiles(param.sequenceFilename, filenames)) {
+    return EXIT_FAILURE;
+  }
+
+  ProfileWriter writer;
+  std::FILE *fp = stdout;
+  if (param.profileFilename != nullptr) {
+    if (!openProfileWriter(writer, param.profileFilename)) {
+      std::cerr << "Failed to open profile file: " << param.profileFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else if (param.dstFilename != nullptr) {
+    fp = std::fopen(param.dstFilename, "w");
+    if (fp == nullptr) {
+      std::cerr << "Failed to open file: " << param.dstFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  bool isIncremental = param.method == EVAL_METHOD_RAY && param.momentMethod == MOMENT_METHOD_SPAN && !param.isRegions;
+  SequenceState state;
+  SequenceStats stats = {0, 0, 0, 0};
+  SpanIndex index;
+  int nFailures = 0;
+  long long t0 = cv::getTickCount();
+  FOREACH (filename, filenames) {
+    cv::Mat srcImage;
+    try {
+      srcImage = cv::imread(*filename);
+    } catch (const cv::Exception &) {
+      srcImage = cv::Mat();
+    }
+    if (srcImage.data == nullptr) {
+      std::cerr << "Failed to read image file: " << *filename << std::endl;
+      nFailures++;
+      continue;
+    }
+    buildSpanIndex(index, fillImage(srcImage, matcher, param.fillMode, param.trimBlank), matcher);
+    std::vector<RegionResult> results;
+    if (isIncremental) {
+      results.assign(1, RegionResult());
+      evalFrame(index, param, state, results[0], stats);
+    } else {
+      evalRegions(index, param, results);
+    }
+    if (param.profileFilename != nullptr) {
+      if (!writeRegionProfiles(writer, filename->c_str(), results, param)) {
+        std::cerr << "Failed to write profile file: " << param.profileFilename << std::endl;
+        nFailures++;
+      }
+    } else {
+      writeRegionCsv(fp, filename->c_str(), results, param, true);
+    }
+  }
+  double elapsed = static_cast<double>(cv::getTickCount() - t0) / cv::getTickFrequency();
+
+  if (param.profileFilename != nullptr) {
+    closeProfileWriter(writer);
+  } else if (fp != stdout) {
+    std::fclose(fp);
+  }
+  int nFrames = static_cast<int>(filenames.size());
+  std::fprintf(stderr, "%d frames (%d failed) in %f s: %f frames/s\n",
+      nFrames, nFailures, elapsed, elapsed > 0.0 ? nFrames / elapsed : 0.0);
+  if (isIncremental) {
+    std::fprintf(stderr, "incremental: %d full frames, %lld changed pixels, %lld of %lld rays cast\n",
+        stats.nFullFrames, stats.nChangedPixels, stats.nCastRays, stats.nRays);
+  }
+  return nFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*!
+ * @brief Evaluate the frame incrementally from the previous frame
+ *
+ * The mask of the frame is packed into 64-bit words and XORed with the mask
+ * of the previous frame, and the moments are updated only with the runs of
+ * the added and removed pixels.  The origin of the rays is kept while the
+ * centroid is within --max-drift from it, and then only the rays which may
+ * sample the changed pixels are cast again.  Otherwise the origin is moved to
+ * the centroid and all rays are cast.  With --max-drift=0, the result is
+ * identical to the evaluation from scratch.
+ * The first frame and the frame whose size is different from the previous
+ * one are evaluated from scratch.
+ * @param [in]     index   Run-length representation of the filled region
+ * @param [in]     param   Parameters of this program
+ * @param [in,out] state   State of the previous frame, which is updated to this frame
+ * @param [out]    result  Result of the frame
+ * @param [in,out] stats   Statistics of the incremental evaluation
+ */
+static void
+evalFrame(const SpanIndex &index, const Param &param, SequenceState &state, RegionResult &result, SequenceStats &stats)
+{
+  int nRays = countRays(param.degreeStep);
+  BitMask mask;
+  buildBitMask(mask, index);
+  // The runs of the columns are built only when any ray is cast
+  SpanIndex columns;
+  stats.nRays += nRays;
+  if (!state.isValid || mask.width != state.mask.width || mask.height != state.mask.height) {
+    state.moments = calcMoment(index);
+    ShapeFeatures features = calcShapeFeatures(state.moments);
+    state.origin = cv::Point2d(features.centroidX, features.centroidY);
+    transposeSpanIndex(index, columns);
+    state.crossPoints = evalArea(index, columns, state.origin, param.degreeStep, param.isSubpixel);
+    stats.nFullFrames++;
+    stats.nCastRays += nRays;
+  } else {
+    std::vector<MaskRun> added;
+    std::vector<MaskRun> removed;
+    diffBitMask(state.mask, mask, added, removed);
+    stats.nChangedPixels += updateMoments(state.moments, added, 1.0);
+    stats.nChangedPixels += updateMoments(state.moments, removed, -1.0);
+    ShapeFeatures features = calcShapeFeatures(state.moments);
+    cv::Point2d gp(features.centroidX, features.centroidY);
+    double drift = std::sqrt((gp.x - state.origin.x) * (gp.x - state.origin.x) + (gp.y - state.origin.y) * (gp.y - state.origin.y));
+    if (!(drift <= param.maxDrift)) {
+      state.origin = gp;
+      transposeSpanIndex(index, columns);
+      state.crossPoints = evalArea(index, columns, state.origin, param.degreeStep, param.isSubpixel);
+      stats.nCastRays += nRays;
+    } else if (!added.empty() || !removed.empty()) {
+      std::vector<unsigned char> isDirty(static_cast<size_t>(nRays), 0);
+      markDirtyRays(added, state.origin, state.crossPoints, param.degreeStep, isDirty);
+      markDirtyRays(removed, state.origin, state.crossPoints, param.degreeStep, isDirty);
+      std::vector<int> dirtyRays;
+      REP_I (i, nRays) {
+        if (isDirty[static_cast<size_t>(i)]) {
+          dirtyRays.push_back(i);
+        }
+      }
+      int nDirtyRays = static_cast<int>(dirtyRays.size());
+      if (nDirtyRays > 0) {
+        transposeSpanIndex(index, columns);
+      }
+      #pragma omp parallel for schedule(dynamic, 16)
+      REP_I (j, nDirtyRays) {
+        int i = dirtyRays[static_cast<size_t>(j)];
+        cv::Point2d cp = castRay(index, columns, state.origin, i * param.degreeStep, param.isSubpixel);
+        state.crossPoints.xs[static_cast<size_t>(i)] = cp.x;
+        state.crossPoints.ys[static_cast<size_t>(i)] = cp.y;
+      }
+      stats.nCastRays += nDirtyRays;
+    }
+  }
+  state.mask.width       = mask.width;
+  state.mask.height      = mask.height;
+  state.mask.wordsPerRow = mask.wordsPerRow;
+  state.mask.words.swap(mask.words);
+  state.isValid = true;
+
+  result.moments     = state.moments;
+  result.features    = calcShapeFeatures(result.moments);
+  result.crossPoints = state.crossPoints;
+  result.distances   = calcResults(state.origin, result.crossPoints, result.summary);
+  result.descriptor  = calcFourierDescriptor(result.distances, param.nFourier);
+}
+
+
+/*!
+ * @brief Add or subtract the moments of the runs of pixels
+ *
+ * The sums of each run are calculated in closed form as calcMoment().
+ * @param [in,out] moments  Raw moments of the region
+ * @param [in]     runs     Runs of the added or removed pixels
+ * @param [in]     sign     1 to add the runs, -1 to subtract them
+ * @return  The number of the pixels of the runs
+ */
+ATTR_NOTHROW static long long
+updateMoments(Moments &moments, const std::vector<MaskRun> &runs, double sign) noexcept
+{
+  long long cnt   = 0;
+  long long sumX  = 0;
+  long long sumY  = 0;
+  double    sumXX = 0.0;
+  double    sumXY = 0.0;
+  double    sumYY = 0.0;
+  FOREACH (run, runs) {
+    long long b = run->begin;
+    long long e = run->end;
+    long long y = run->y;
+    long long runCnt  = e - b;
+    long long runSumX = (b + e - 1) * (e - b) / 2;
+    cnt   += runCnt;
+    sumX  += runSumX;
+    sumY  += y * runCnt;
+    sumXX += static_cast<double>(((e - 1) * e * (2 * e - 1) - (b - 1) * b * (2 * b - 1)) / 6);
+    sumXY += static_cast<double>(y * runSumX);
+    sumYY += static_cast<double>(y) * static_cast<double>(y * runCnt);
+  }
+  moments.m00 += sign * static_cast<double>(cnt);
+  moments.m10 += sign * static_cast<double>(sumX);
+  moments.m01 += sign * static_cast<double>(sumY);
+  moments.m20 += sign * sumXX;
+  moments.m11 += sign * sumXY;
+  moments.m02 += sign * sumYY;
+  return cnt;
+}
+
+
+/*!
+ * @brief Mark the rays which may sample the changed pixels
+ *
+ * castRay() samples the pixels within 0.5 pixel across the ray, and refines
+ * the crossing with the pixels within 1 pixel of the ray.  So each run is
+ * expanded by 1.5 pixels, and the rays in the angular range of the expanded
+ * rectangle seen from the origin are marked if the rectangle is nearer than
+ * the previous crossing plus the margin of the refinement.  If the
+ * rectangle contains the origin, all rays are marked.
+ * @param [in]     runs         Runs of the changed pixels
+ * @param [in]     origin       Origin of the rays
+ * @param [in]     crossPoints  Points in the boundary for each angle of the previous frame
+ * @param [in]     degreeStep   Angular step of the rays in degree
+ * @param [in,out] isDirty      Flags of the rays to cast again
+ */
+ATTR_NOTHROW static void
+markDirtyRays(const std::vector<MaskRun> &runs, const cv::Point2d &origin, const CrossPoints &crossPoints, double degreeStep, std::vector<unsigned char> &isDirty) noexcept
+{
+  static const double PIXEL_MARGIN    = 1.5;
+  static const double DISTANCE_MARGIN = 2.5;
+
+  int nRays = static_cast<int>(isDirty.size());
+  FOREACH (run, runs) {
+    double left   = run->begin - PIXEL_MARGIN;
+    double right  = run->end - 1 + PIXEL_MARGIN;
+    double top    = run->y - PIXEL_MARGIN;
+    double bottom = run->y + PIXEL_MARGIN;
+    if (left <= origin.x && origin.x <= right && top <= origin.y && origin.y <= bottom) {
+      std::fill(isDirty.begin(), isDirty.end(), static_cast<unsigned char>(1));
+      return;
+    }
+    double nearX = std::max(0.0, std::max(left - origin.x, origin.x - right));
+    double nearY = std::max(0.0, std::max(top - origin.y, origin.y - bottom));
+    double nearDistance = std::sqrt(nearX * nearX + nearY * nearY);
+
+    // The rectangle doesn't contain the origin, so that its angular range is less than 180 degrees around its center
+    double center = std::atan2((top + bottom) / 2.0 - origin.y, (left + right) / 2.0 - origin.x);
+    const double cornerXs[] = {left, right, right, left};
+    const double cornerYs[] = {top, top, bottom, bottom};
+    double lower = 0.0;
+    double upper = 0.0;
+    REP (k, LENGTH(cornerXs)) {
+      double diff = std::atan2(cornerYs[k] - origin.y, cornerXs[k] - origin.x) - center;
+      if (diff > M_PI) {
+        diff -= 2.0 * M_PI;
+      } else if (diff < -M_PI) {
+        diff += 2.0 * M_PI;
+      }
+      lower = std::min(lower, diff);
+      upper = std::max(upper, diff);
+    }
+    lower = radianToDegree(center + lower);
+    upper = radianToDegree(center + upper);
+    if (lower < 0.0) {
+      lower += 360.0;
+      upper += 360.0;
+    }
+    // The range may wrap around 360 degrees
+    REP (turn, 2) {
+      double base = 360.0 * static_cast<double>(turn);
+      int first = std::max(0, static_cast<int>(std::ceil((lower - base) / degreeStep)));
+      int last  = std::min(nRays - 1, static_cast<int>(std::floor((upper - base) / degreeStep)));
+      FOR (i, first, last + 1) {
+        size_t idx = static_cast<size_t>(i);
+        double dx = crossPoints.xs[idx] - origin.x;
+        double dy = crossPoints.ys[idx] - origin.y;
+        if (nearDistance <= std::sqrt(dx * dx + dy * dy) + DISTANCE_MARGIN) {
+          isDirty[idx] = 1;
+        }
+      }
+    }
+  }
+}
+
+
+/*!
+ * @brief Read the rectangles from the roi-file
+ *
+ * Each line of the roi-file is "NAME,X,Y,WIDTH,HEIGHT".  Empty lines and
+ * lines which begin with '#' are ignored.
+ * @param [in]  filename  A name of the roi-file
+ * @param [out] rois      The rectangles
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+readRoiFile(const char *filename, std::vector<Roi> &rois)
+{
+  std::vector<std::string> lines;
+  if (!readManifest(filename, lines)) {
+    return false;
+  }
+  rois.assign(lines.size(), Roi());
+  REP (i, lines.size()) {
+    std::string::size_type idx = lines[i].find(',');
+    Roi &roi = rois[i];
+    if (idx == std::string::npos
+        || std::sscanf(lines[i].c_str() + idx + 1, "%d,%d,%d,%d", &roi.rect.x, &roi.rect.y, &roi.rect.width, &roi.rect.height) != 4
+        || roi.rect.width < 0 || roi.rect.height < 0) {
+      std::cerr << "Invalid line of roi-file: " << lines[i] << std::endl;
+      return false;
+    }
+    roi.name = lines[i].substr(0, idx);
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Output the area and the centroid of the region in each rectangle
+ *
+ * The summed-area tables are built once, and then the moments of each
+ * rectangle are obtained by four lookups of each table.  Each line of the
+ * output is "NAME,X,Y,WIDTH,HEIGHT,AREA,CENTROID_X,CENTROID_Y", where the
+ * rectangle is clipped to the image and the centroid is empty if the area
+ * is zero.
+ * @param [in] index  Run-length representation of the filled region
+ * @param [in] rois   The rectangles
+ * @param [in] fp     File pointer of output
+ */
+static void
+evalRois(const SpanIndex &index, const std::vector<Roi> &rois, std::FILE *fp)
+{
+  MomentTable table;
+  buildMomentTable(table, index);
+  FOREACH (roi, rois) {
+    cv::Rect rect = roi->rect & cv::Rect(0, 0, index.width, index.height);
+    RectMoments moments = queryMomentTable(table, rect);
+    std::fprintf(fp, "%s,%d,%d,%d,%d,%lld,", roi->name.c_str(), rect.x, rect.y, rect.width, rect.height, moments.count);
+    if (moments.count > 0) {
+      std::fprintf(fp, "%f,%f\n",
+          static_cast<double>(moments.sumX) / static_cast<double>(moments.count),
+          static_cast<double>(moments.sumY) / static_cast<double>(moments.count));
+    } else {
+      std::fputs(",\n", fp);
+    }
+  }
+}
+
+
+/*!
+ * @brief Measure the processing time of building the span index,
+ *        calculating moment and casting the rays with each number of threads
+ *
+ * Each measurement is repeated and the minimum time is reported.
+ * @param [in] image       A filled image
+ * @param [in] matcher     Classifier of the color of filled region
+ * @param [in] degreeStep  Angular step of the rays in degree
+ */
+static void
+benchmark(const cv::Mat &image, const ColorMatcher &matcher, double degreeStep)
+{
+  static const int N_TRIALS = 10;
+
+#ifdef _OPENMP
+  int maxThreads = omp_get_max_threads();
+#else
+  int maxThreads = 1;
+#endif
+  std::printf("threads,index[ms],moment[ms],rays[ms],speedup\n");
+  double baseTime = 0.0;
+  for (int nThreads = 1; nThreads <= maxThreads; nThreads++) {
+#ifdef _OPENMP
+    omp_set_num_threads(nThreads);
+#endif
+    double indexTime  = -1.0;
+    double momentTime = -1.0;
+    double raysTime   = -1.0;
+    LOOP (N_TRIALS) {
+      SpanIndex index;
+      long long t0 = cv::getTickCount();
+      buildSpanIndex(index, image, matcher);
+      long long t1 = cv::getTickCount();
+      ShapeFeatures features = calcShapeFeatures(calcMoment(index));
+      long long t2 = cv::getTickCount();
+      SpanIndex columns;
+      transposeSpanIndex(index, columns);
+      evalArea(index, columns, cv::Point2d(features.centroidX, features.centroidY), degreeStep, false);
+      long long t3 = cv::getTickCount();
+      double dt1 = static_cast<double>(t1 - t0) * 1000.0 / cv::getTickFrequency();
+      double dt2 = static_cast<double>(t2 - t1) * 1000.0 / cv::getTickFrequency();
+      double dt3 = static_cast<double>(t3 - t2) * 1000.0 / cv::getTickFrequency();
+      if (indexTime < 0.0 || indexTime > dt1) indexTime = dt1;
+      if (momentTime < 0.0 || momentTime > dt2) momentTime = dt2;
+      if (raysTime < 0.0 || raysTime > dt3) raysTime = dt3;
+    }
+    double totalTime = indexTime + momentTime + raysTime;
+    if (nThreads == 1) {
+      baseTime = totalTime;
+    }
+    std::printf("%d,%f,%f,%f,%f\n", nThreads, indexTime, momentTime, raysTime, baseTime / totalTime);
+  }
+#ifdef _OPENMP
+  omp_set_num_threads(maxThreads);
+#endif
+}
+
+
+/*!
+ * @brief Compare the processing time and the accuracy of the methods to find
+ *        the boundary at 1, 0.1 and 0.01 degree steps
+ *
+ * The accuracy is the mean and maximum absolute difference of the distances
+ * from the ones of the ray method, which is the reference.  The adaptive
+ * sampling is compared by its distances which are resampled to the step.
+ * @param [in] index  Run-length representation of the filled region
+ * @param [in] gp     Center of gravity of the filled region in image
+ */
+static void
+compareMethods(const SpanIndex &index, const cv::Point2d &gp)
+{
+  static const int        N_TRIALS           = 3;
+  static const double     STEPS[]            = {1.0, 0.1, 0.01};
+  static const EvalMethod METHODS[]          = {EVAL_METHOD_RAY, EVAL_METHOD_RAY, EVAL_METHOD_CONTOUR, EVAL_METHOD_POLAR, EVAL_METHOD_POLAR};
+  static const bool       SUBPIXELS[]        = {false, true, false, false, true};
+  static const char      *NAMES[]            = {"ray", "ray+subpixel", "contour", "polar", "polar+subpixel", "ray+adaptive"};
+  static const double     ADAPTIVE_THRESHOLD = 1.0;
+
+  std::printf("\nstep,method,time[ms],meanDiff,maxDiff,rays\n");
+  REP (i, LENGTH(STEPS)) {
+    std::vector<double> reference;
+    // The last one is the adaptive sampling, whose distances are resampled to the uniform step
+    REP (j, LENGTH(NAMES)) {
+      bool isAdaptive = j == LENGTH(METHODS);
+      double time = -1.0;
+      CrossPoints crossPoints;
+      std::vector<double> angles;
+      LOOP (N_TRIALS) {
+        long long t0 = cv::getTickCount();
+        if (isAdaptive) {
+          SpanIndex columns;
+          transposeSpanIndex(index, columns);
+          crossPoints = evalAreaAdaptive(index, columns, gp, STEPS[i], ADAPTIVE_THRESHOLD, false, angles);
+        } else {
+          crossPoints = calcProfile(index, gp, STEPS[i], METHODS[j], BIN_MODE_MIN, SUBPIXELS[j]);
+        }
+        long long t1 = cv::getTickCount();
+        double dt = static_cast<double>(t1 - t0) * 1000.0 / cv::getTickFrequency();
+        if (time < 0.0 || time > dt) time = dt;
+      }
+      RadiusSummary summary;
+      std::vector<double> scores = calcResults(gp, crossPoints, summary);
+      if (isAdaptive) {
+        scores = resampleProfile(angles, scores, STEPS[i]);
+      }
+      if (j == 0) {
+        reference = scores;
+      }
+      double sumDiff = 0.0;
+      double maxDiff = 0.0;
+      REP (k, scores.size()) {
+        double diff = std::fabs(scores[k] - reference[k]);
+        sumDiff += diff;
+        maxDiff = std::max(maxDiff, diff);
+      }
+      std::printf("%g,%s,%f,%f,%f,%lu\n", STEPS[i], NAMES[j], time, sumDiff / static_cast<double>(scores.size()), maxDiff,
+          static_cast<unsigned long>(crossPoints.xs.size()));
+    }
+  }
+}
+
+
+/*!
+ * @brief Compare the processing time and the result of the methods to
+ *        calculate the moments
+ *
+ * The difference is the maximum absolute difference of the moments from the
+ * ones of the span method, which is the reference.  It is zero unless the
+ * region has holes or more than one component.
+ * @param [in] index  Run-length representation of the filled region
+ */
+static void
+compareMoments(const SpanIndex &index)
+{
+  static const int          N_TRIALS  = 10;
+  static const MomentMethod METHODS[] = {MOMENT_METHOD_SPAN, MOMENT_METHOD_CONTOUR};
+  static const char        *NAMES[]   = {"span", "contour"};
+
+  std::printf("\nmoment,time[ms],m00,maxDiff\n");
+  Moments reference = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  REP (i, LENGTH(METHODS)) {
+    double time = -1.0;
+    Moments moments = reference;
+    LOOP (N_TRIALS) {
+      long long t0 = cv::getTickCount();
+      moments = METHODS[i] == MOMENT_METHOD_CONTOUR ? calcMomentByContour(index) : calcMoment(index);
+      long long t1 = cv::getTickCount();
+      double dt = static_cast<double>(t1 - t0) * 1000.0 / cv::getTickFrequency();
+      if (time < 0.0 || time > dt) time = dt;
+    }
+    if (i == 0) {
+      reference = moments;
+    }
+    double maxDiff = std::max(
+        std::max(std::fabs(moments.m00 - reference.m00), std::fabs(moments.m10 - reference.m10)),
+        std::max(std::fabs(moments.m01 - reference.m01), std::fabs(moments.m20 - reference.m20)));
+    maxDiff = std::max(maxDiff, std::max(std::fabs(moments.m11 - reference.m11), std::fabs(moments.m02 - reference.m02)));
+    std::printf("%s,%f,%.0f,%.0f\n", NAMES[i], time, moments.m00, maxDiff);
+  }
+}
+
+
+/*!
+ * @brief Compare the processing time of casting the rays from the candidate
+ *        centers with the representation of the columns which is built for
+ *        each center and which is shared by all centers
+ *
+ * The time of the separate columns includes the time to build them for each
+ * center, and the time of the shared columns includes it only in the row of
+ * "columns".
+ * @param [in] index     Run-length representation of the filled region
+ * @param [in] features  Shape features of the filled region
+ */
+static void
+compareCenters(const SpanIndex &index, const ShapeFeatures &features)
+{
+  static const int    N_TRIALS    = 3;
+  static const double DEGREE_STEP = 0.01;
+
+  std::printf("\ncenter,x,y,separate[ms],shared[ms]\n");
+  SpanIndex columns;
+  double columnTime = -1.0;
+  LOOP (N_TRIALS) {
+    long long t0 = cv::getTickCount();
+    transposeSpanIndex(index, columns);
+    long long t1 = cv::getTickCount();
+    double dt = static_cast<double>(t1 - t0) * 1000.0 / cv::getTickFrequency();
+    if (columnTime < 0.0 || columnTime > dt) columnTime = dt;
+  }
+  std::printf("columns,,,,%f\n", columnTime);
+  double totalSeparateTime = 0.0;
+  double totalSharedTime = columnTime;
+  REP_I (i, N_CENTER_TYPES) {
+    cv::Point2d center = findCenter(index, features, static_cast<CenterType>(i));
+    double separateTime = -1.0;
+    double sharedTime = -1.0;
+    LOOP (N_TRIALS) {
+      long long t0 = cv::getTickCount();
+      calcProfile(index, center, DEGREE_STEP, EVAL_METHOD_RAY, BIN_MODE_MIN, false);
+      long long t1 = cv::getTickCount();
+      evalArea(index, columns, center, DEGREE_STEP, false);
+      long long t2 = cv::getTickCount();
+      double dt1 = static_cast<double>(t1 - t0) * 1000.0 / cv::getTickFrequency();
+      double dt2 = static_cast<double>(t2 - t1) * 1000.0 / cv::getTickFrequency();
+      if (separateTime < 0.0 || separateTime > dt1) separateTime = dt1;
+      if (sharedTime < 0.0 || sharedTime > dt2) sharedTime = dt2;
+    }
+    totalSeparateTime += separateTime;
+    totalSharedTime += sharedTime;
+    std::printf("%s,%f,%f,%f,%f\n", CENTER_TYPE_NAMES[i], center.x, center.y, separateTime, sharedTime);
   }
-  return scores;
+  std::printf("total,,,%f,%f\n", totalSeparateTime, totalSharedTime);
 }
@@ -0,0 +1,333 @@
+/*!
+ * @brief Convert the binary profile file which evalArea writes into csv
+ *
+ * Each record is converted into the same csv-format as evalArea writes
+ * without --profile-file.
+ *
+ * @author  koturn 0;
+ * @file    profileToCsv.cpp
+ */
+#include <gccUtil/nowarnings.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <commonUtil/compat.h>
+#include <commonUtil/foreach.h>
+#include <gccUtil/restorewarnings.h>
+
+#include "../util/include/mmapUtil.h"
+#include "../util/include/profileUtil.h"
+
+
+//! The structre of parameters for this program
+typedef struct {
+  const char *srcFilename;  //!< A name of binary profile file
+  const char *dstFilename;  //!< A name of output csv-file
+  const char *dstDirname;   //!< A name of directory to output csv-file for each record
+  long        recordIndex;  //!< Index of the record to convert (negative value means all records)
+  bool        isList;       //!< List records instead of converting or not
+} Param;
+
+static Param
+parseArguments(int argc, char *argv[]);
+
+ATTR_NOTHROW ALWAYSINLINE static void
+showUsage(const char *progname) noexcept;
+
+static void
+listRecords(const MappedFile &file, const std::vector<unsigned long long> &offsets);
+
+static bool
+writeRecord(std::FILE *fp, const ProfileRecordView &view, bool isShowName);
+
+static std::string
+toCsvFilename(const char *dirname, const ProfileRecordView &view, size_t recordIndex, std::set<std::string> &usedNames);
+
+
+/*!
+ * @brief The entry point of this program
+ * @param [in] argc  A number of comand-line arguments
+ * @param [in] argv  Command-line arguments.
+ * @return  exit-status
+ */
+int
+main(int argc, char *argv[])
+{
+  Param param;
+  try {
+    param = parseArguments(argc, argv);
+  } catch (const char *errmsg) {
+    std::cerr << "ERROR: " << errmsg << std::endl;
+    showUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  MappedFile file;
+  if (!openMappedFile(file, param.srcFilename)) {
+    std::cerr << "Failed to open profile file: " << param.srcFilename << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<unsigned long long> offsets;
+  if (!listProfileRecords(file, param.srcFilename, offsets)) {
+    std::cerr << "Invalid profile file: " << param.srcFilename << std::endl;
+    closeMappedFile(file);
+    return EXIT_FAILURE;
+  }
+  if (param.isList) {
+    listRecords(file, offsets);
+    closeMappedFile(file);
+    return EXIT_SUCCESS;
+  }
+  if (param.recordIndex >= static_cast<long>(offsets.size())) {
+    std::cerr << "Record index is out of range: " << param.recordIndex << std::endl;
+    closeMappedFile(file);
+    return EXIT_FAILURE;
+  }
+
+  size_t first = param.recordIndex < 0 ? 0 : static_cast<size_t>(param.recordIndex);
+  size_t last  = param.recordIndex < 0 ? offsets.size() : first + 1;
+  std::FILE *fp = stdout;
+  if (param.dstDirname == nullptr && param.dstFilename != nullptr) {
+    fp = std::fopen(param.dstFilename, "w");
+    if (fp == nullptr) {
+      std::cerr << "Failed to open file: " << param.dstFilename << std::endl;
+      closeMappedFile(file);
+      return EXIT_FAILURE;
+    }
+  }
+
+  int status = EXIT_SUCCESS;
+  std::set<std::string> usedNames;
+  FOR (i, static_cast<int>(first), static_cast<int>(last)) {
+    ProfileRecordView view;
+    parseProfileRecord(file, offsets[static_cast<size_t>(i)], view);
+    if (param.dstDirname == nullptr) {
+      if (!writeRecord(fp, view, last - first > 1)) {
+        std::cerr << "Invalid record: " << i << std::endl;
+        status = EXIT_FAILURE;
+      }
+      continue;
+    }
+    std::string dstFilename = toCsvFilename(param.dstDirname, view, static_cast<size_t>(i), usedNames);
+    std::FILE *recordFp = std::fopen(dstFilename.c_str(), "w");
+    if (recordFp == nullptr) {
+      std::cerr << "Failed to open file: " << dstFilename << std::endl;
+      status = EXIT_FAILURE;
+      continue;
+    }
+    if (!writeRecord(recordFp, view, false)) {
+      std::cerr << "Invalid record: " << i << std::endl;
+      status = EXIT_FAILURE;
+    }
+    std::fclose(recordFp);
+  }
+  if (fp != stdout) {
+    std::fclose(fp);
+  }
+  closeMappedFile(file);
+  return status;
+}
+
+
+/*!
+ * @brief Parse comamnd-line arguments and set parameters.
+ *
+ * 'argv' is sorted after called getopt_long().
+ * @param [in]     argc  A number of command-line arguments
+ * @param [in,out] argv  Coomand-line arguments
+ * @return Parameter structure of this program.
+ */
+static Param
+parseArguments(int argc, char *argv[])
+{
+  static const struct option opts[] = {
+    {"output-dir", required_argument, nullptr, 'd'},
+    {"help",       no_argument,       nullptr, 'h'},
+    {"list",       no_argument,       nullptr, 'l'},
+    {"output",     required_argument, nullptr, 'o'},
+    {"record",     required_argument, nullptr, 'r'},
+    {0, 0, 0, 0}   // must be filled with zero
+  };
+
+  int ret;
+  int optidx;
+  Param param = {
+    nullptr,
+    nullptr,
+    nullptr,
+    -1,
+    false
+  };
+  while ((ret = getopt_long(argc, argv, "d:hlo:r:", opts, &optidx)) != -1) {
+    switch (ret) {
+      case 'd':  // -d or --output-dir
+        param.dstDirname = optarg;
+        break;
+      case 'h':  // -h or --help
+        showUsage(argv[0]);
+        std::exit(EXIT_SUCCESS);
+      case 'l':  // -l or --list
+        param.isList = true;
+        break;
+      case 'o':  // -o or --output
+        param.dstFilename = optarg;
+        break;
+      case 'r':  // -r or --record
+        if (std::sscanf(optarg, "%ld", &param.recordIndex) != 1) {
+          throw "Invalid option argument: -r, --record";
+        }
+        if (param.recordIndex < 0) {
+          throw "Invalid value for option argument: -r, --record (negative value is not allowed)";
+        }
+        break;
+      case '?':  // unknown option
+        showUsage(argv[0]);
+        std::exit(EXIT_FAILURE);
+    }
+  }
+  if (optind != argc - 1) {
+    throw "Invalid arguments";
+  }
+  param.srcFilename = argv[optind];
+  return param;
+}
+
+
+/*!
+ * @brief Show an usage of this program.
+ * @param [in] progname  A name of this program
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+showUsage(const char *progname) noexcept
+{
+  std::cout << "[Usage]\n"
+            << "  $ " << progname << " FILENAME [options]\n\n"
+               "[options]\n"
+               "  -d DIRNAME, --output-dir=DIRNAME\n"
+               "    Write each record to DIRNAME/NAME.csv, where NAME is the name of\n"
+               "    the record without its directory and suffix\n"
+               "    If NAME is already used by a former record, _INDEX is appended to it\n"
+               "  -h, --help\n"
+               "    show help and exit\n"
+               "  -l, --list\n"
+               "    List the records (index, name, the number of points and scalars) and exit\n"
+               "  -o FILENAME, --output=FILENAME\n"
+               "    Specify output csv-file name\n"
+               "    If this option isn't specified, output is stdout\n"
+               "  -r INDEX, --record=INDEX\n"
+               "    Convert only the INDEX-th record (zero-origin)\n"
+               "      DEFAULT_VALUE = all records"
+            << std::endl;
+}
+
+
+/*!
+ * @brief List the records in the profile file
+ *
+ * Each line has the index, the name, the number of points and the scalars
+ * of the record.
+ * @param [in] file     The mapped profile file
+ * @param [in] offsets  Offsets of the records
+ */
+static void
+listRecords(const MappedFile &file, const std::vector<unsigned long long> &offsets)
+{
+  REP (i, offsets.size()) {
+    ProfileRecordView view;
+    parseProfileRecord(file, offsets[i], view);
+    std::printf("%lu,%s,%lu",
+        static_cast<unsigned long>(i),
+        std::string(view.name, view.nameLength).c_str(),
+        static_cast<unsigned long>(view.nPoints));
+    REP (j, view.nScalars) {
+      std::printf(",%f", getProfileScalar(view, j));
+    }
+    std::putchar('\n');
+  }
+}
+
+
+/*!
+ * @brief Write the record in csv-format
+ *
+ * The angles are written as they are, and the number of their decimal places
+ * is taken from the finest step of the angles, so that the records of the
+ * adaptive sampling of evalArea are also written.
+ * @param [in] fp          File pointer of output
+ * @param [in] view        A record
+ * @param [in] isShowName  Write the name of the record as a comment line or not
+ * @return  true if the record has the columns of angle and distance, otherwise false
+ */
+static bool
+writeRecord(std::FILE *fp, const ProfileRecordView &view, bool isShowName)
+{
+  if (view.nColumns <= PROFILE_COLUMN_DISTANCE) {
+    return false;
+  }
+  if (isShowName) {
+    std::fprintf(fp, "# %s\n", std::string(view.name, view.nameLength).c_str());
+  }
+  std::vector<double> angles(view.nPoints);
+  std::vector<double> distances(view.nPoints);
+  REP (i, view.nPoints) {
+    angles[i]    = getProfileValue(view, PROFILE_COLUMN_ANGLE, i);
+    distances[i] = getProfileValue(view, PROFILE_COLUMN_DISTANCE, i);
+  }
+  double degreeStep = 360.0;
+  for (size_t i = 1; i < angles.size(); i++) {
+    degreeStep = std::min(degreeStep, angles[i] - angles[i - 1]);
+  }
+  writeAngleProfileCsv(fp, angles, distances, degreeStep);
+  return true;
+}
+
+
+/*!
+ * @brief Make the name of csv-file for the record
+ *
+ * If the name of the record is empty, the index of the record is used.
+ * The name of the record of a region, "NAME#INDEX", is converted into
+ * NAME_INDEX.  If the name is already used by a former record, for example
+ * the images of the same name in different directories or the image which
+ * is appended in several runs, "_" and the index of the record are appended
+ * to it, so that no csv-file is overwritten.
+ * @param [in]     dirname      A name of output directory
+ * @param [in]     view         A record
+ * @param [in]     recordIndex  Index of the record
+ * @param [in,out] usedNames    The names which are used by the former records
+ * @return  A name of csv-file
+ */
+static std::string
+toCsvFilename(const char *dirname, const ProfileRecordView &view, size_t recordIndex, std::set<std::string> &usedNames)
+{
+  std::string name(view.name, view.nameLength);
+  std::string regionSuffix;
+  std::string::size_type idx = name.find_last_of('#');
+  if (idx != std::string::npos) {
+    regionSuffix = "_" + name.substr(idx + 1);
+    name = name.substr(0, idx);
+  }
+  idx = name.find_last_of("/\\");
+  if (idx != std::string::npos) {
+    name = name.substr(idx + 1);
+  }
+  idx = name.find_last_of('.');
+  if (idx != std::string::npos && idx != 0) {
+    name = name.substr(0, idx);
+  }
+  name += regionSuffix;
+  char buf[32];
+  std::sprintf(buf, "%lu", static_cast<unsigned long>(recordIndex));
+  if (name.empty()) {
+    name = buf;
+  }
+  while (!usedNames.insert(name).second) {
+    name += std::string("_") + buf;
+  }
+  return std::string(dirname) + "/" + name + ".csv";
+}
@@ -0,0 +1,507 @@
+/*!
+ * @brief Calculate the rotation-invariant distances between the shapes of the
+ *        profiles which evalArea writes
+ *
+ * Each profile is resampled to the same number of angles in float32, and the
+ * distance of two profiles is the root mean square of the differences of the
+ * distances at the best rotation.  The distance matrix is written into the
+ * file mapped into memory, or only the nearest profiles of each profile are
+ * written in csv-format.
+ *
+ * @author  koturn 0;
+ * @file    shapeDistance.cpp
+ */
+#include <gccUtil/nowarnings.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#include <commonUtil/compat.h>
+#include <commonUtil/foreach.h>
+#include <gccUtil/restorewarnings.h>
+
+#include "../util/include/distanceUtil.h"
+#include "../util/include/mmapUtil.h"
+#include "../util/include/neighborUtil.h"
+#include "../util/include/profileUtil.h"
+#include "../util/include/timeUtil.h"
+
+
+//! The structre of parameters for this program
+typedef struct {
+  const char  *dstFilename;  //!< A name of output matrix file, or csv-file in top-k mode
+  char *const *srcFilenames; //!< Names of binary profile files
+  int          nSrcFiles;    //!< The number of binary profile files
+  int          nPoints;      //!< The number of angles to resample each profile to
+  int          shiftStep;    //!< Step of the rotations in the number of angles
+  int          topK;         //!< The number of the nearest profiles to write (0 means the whole matrix)
+  bool         isNormalize;  //!< Divide each profile by its mean or not
+} Param;
+
+static const char     MATRIX_MAGIC[8]    = {'E', 'V', 'D', 'M', 'A', 'T', '\0', '\0'};  //!< Magic of the matrix file
+static const unsigned MATRIX_VERSION     = 1;   //!< Version of the format of the matrix file
+static const size_t   MATRIX_HEADER_SIZE = 32;  //!< Size of the header of the matrix file
+static const int      TILE_SIZE          = 64;  //!< The number of profiles in a side of a tile
+
+//! Profiles which are resampled to the same number of angles
+struct ProfileSet {
+  int                      nProfiles;  //!< The number of profiles
+  int                      nPoints;    //!< The number of angles of each profile
+  size_t                   stride;     //!< The number of values of each profile
+  std::vector<float>       values;     //!< The distances of each profile, which are repeated twice for the rotations
+  std::vector<float>       norms;      //!< L2 norm of each profile
+  std::vector<std::string> names;      //!< Names of the profiles
+
+  ProfileSet() :
+    nProfiles(0),
+    nPoints(0),
+    stride(0),
+    values(),
+    norms(),
+    names()
+  {}
+};
+
+
+static Param
+parseArguments(int argc, char *argv[]);
+
+ATTR_NOTHROW ALWAYSINLINE static void
+showUsage(const char *progname) noexcept;
+
+static bool
+readProfiles(const char *filename, const Param &param, ProfileSet &set);
+
+static bool
+writeMatrix(const ProfileSet &set, const Param &param);
+
+static void
+writeNeighbors(std::FILE *fp, const ProfileSet &set, const Param &param);
+
+ATTR_NOTHROW static float
+calcShapeDistance(const ProfileSet &set, int i, int j, int shiftStep) noexcept;
+
+/*!
+ * @brief The entry point of this program
+ * @param [in] argc  A number of comand-line arguments
+ * @param [in] argv  Command-line arguments.
+ * @return  exit-status
+ */
+int
+main(int argc, char *argv[])
+{
+  Param param;
+  try {
+    param = parseArguments(argc, argv);
+  } catch (const char *errmsg) {
+    std::cerr << "ERROR: " << errmsg << std::endl;
+    showUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  ProfileSet set;
+  set.nPoints = param.nPoints;
+  // Each profile is followed by its copy, and padded to a multiple of four values
+  set.stride  = (2 * static_cast<size_t>(param.nPoints) + 3) & ~static_cast<size_t>(3);
+  REP_I (i, param.nSrcFiles) {
+    if (!readProfiles(param.srcFilenames[i], param, set)) {
+      return EXIT_FAILURE;
+    }
+  }
+  if (set.nProfiles == 0) {
+    std::cerr << "No profile is found" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+#ifdef _OPENMP
+  int nThreads = omp_get_max_threads();
+#else
+  int nThreads = 1;
+#endif
+  double t0 = getSeconds();
+  if (param.topK == 0) {
+    if (!writeMatrix(set, param)) {
+      std::cerr << "Failed to write matrix file: " << param.dstFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else {
+    std::FILE *fp = param.dstFilename == nullptr ? stdout : std::fopen(param.dstFilename, "w");
+    if (fp == nullptr) {
+      std::cerr << "Failed to open file: " << param.dstFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+    writeNeighbors(fp, set, param);
+    if (fp != stdout) {
+      std::fclose(fp);
+    }
+  }
+  double elapsed = getSeconds() - t0;
+
+  double nPairs = static_cast<double>(set.nProfiles) * static_cast<double>(set.nProfiles - 1) / 2.0;
+  std::fprintf(stderr, "%d profiles (%.0f pairs) in %f s with %d threads: %f pairs/s\n",
+      set.nProfiles, nPairs, elapsed, nThreads, elapsed > 0.0 ? nPairs / elapsed : 0.0);
+  return EXIT_SUCCESS;
+}
+
+
+/*!
+ * @brief Parse comamnd-line arguments and set parameters.
+ *
+ * 'argv' is sorted after called getopt_long().
+ * @param [in]     argc  A number of command-line arguments
+ * @param [in,out] argv  Coomand-line arguments
+ * @return Parameter structure of this program.
+ */
+static Param
+parseArguments(int argc, char *argv[])
+{
+  static const struct option opts[] = {
+    {"normalize",  no_argument,       nullptr, 0},
+    {"points",     required_argument, nullptr, 1},
+    {"shift-step", required_argument, nullptr, 2},
+    {"help",       no_argument,       nullptr, 'h'},
+    {"top-k",      required_argument, nullptr, 'k'},
+    {"output",     required_argument, nullptr, 'o'},
+    {0, 0, 0, 0}   // must be filled with zero
+  };
+
+  int ret;
+  int optidx;
+  Param param = {
+    nullptr,
+    nullptr,
+    0,
+    128,
+    1,
+    0,
+    false
+  };
+  while ((ret = getopt_long(argc, argv, "hk:o:", opts, &optidx)) != -1) {
+    switch (ret) {
+      case 0:    // --normalize
+        param.isNormalize = true;
+        break;
+      case 1:    // --points
+        if (std::sscanf(optarg, "%d", &param.nPoints) != 1) {
+          throw "Invalid option argument: --points";
+        }
+        if (param.nPoints <= 0) {
+          throw "Invalid value for option argument: --points (must be positive)";
+        }
+        break;
+      case 2:    // --shift-step
+        if (std::sscanf(optarg, "%d", &param.shiftStep) != 1) {
+          throw "Invalid option argument: --shift-step";
+        }
+        if (param.shiftStep <= 0) {
+          throw "Invalid value for option argument: --shift-step (must be positive)";
+        }
+        break;
+      case 'h':  // -h or --help
+        showUsage(argv[0]);
+        std::exit(EXIT_SUCCESS);
+      case 'k':  // -k or --top-k
+        if (std::sscanf(optarg, "%d", &param.topK) != 1) {
+          throw "Invalid option argument: -k, --top-k";
+        }
+        if (param.topK <= 0) {
+          throw "Invalid value for option argument: -k, --top-k (must be positive)";
+        }
+        break;
+      case 'o':  // -o or --output
+        param.dstFilename = optarg;
+        break;
+      case '?':  // unknown option
+        showUsage(argv[0]);
+        std::exit(EXIT_FAILURE);
+    }
+  }
+  if (optind >= argc) {
+    throw "Invalid arguments";
+  }
+  if (param.topK == 0 && param.dstFilename == nullptr) {
+    throw "Output matrix file must be specified with -o, --output";
+  }
+  param.srcFilenames = argv + optind;
+  param.nSrcFiles    = argc - optind;
+  return param;
+}
+
+
+/*!
+ * @brief Show an usage of this program.
+ * @param [in] progname  A name of this program
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+showUsage(const char *progname) noexcept
+{
+  std::cout << "[Usage]\n"
+            << "  $ " << progname << " FILENAME... [options]\n\n"
+               "[options]\n"
+               "  -h, --help\n"
+               "    show help and exit\n"
+               "  -k K, --top-k=K\n"
+               "    Write the K nearest profiles of each profile in csv-format\n"
+               "    (name, rank, name of the neighbor, distance) instead of the matrix\n"
+               "  -o FILENAME, --output=FILENAME\n"
+               "    Specify output matrix file name (required without -k)\n"
+               "    With -k, output is stdout if this option isn't specified\n"
+               "  --normalize\n"
+               "    Divide each profile by its mean distance so that the size is ignored\n"
+               "  --points=M\n"
+               "    Resample each profile to M angles\n"
+               "      DEFAULT_VALUE = 128\n"
+               "  --shift-step=S\n"
+               "    Try the rotations of every S angles of the resampled profile\n"
+               "      DEFAULT_VALUE = 1"
+            << std::endl;
+}
+
+
+/*!
+ * @brief Read all records of the profile file and append them to the set
+ * @param [in]     filename  A name of binary profile file
+ * @param [in]     param     Parameters of this program
+ * @param [in,out] set       Profiles which are resampled
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+readProfiles(const char *filename, const Param &param, ProfileSet &set)
+{
+  MappedFile file;
+  if (!openMappedFile(file, filename)) {
+    std::cerr << "Failed to open profile file: " << filename << std::endl;
+    return false;
+  }
+  std::vector<unsigned long long> offsets;
+  if (!listProfileRecords(file, filename, offsets)) {
+    std::cerr << "Invalid profile file: " << filename << std::endl;
+    closeMappedFile(file);
+    return false;
+  }
+
+  size_t first = static_cast<size_t>(set.nProfiles);
+  set.values.resize((first + offsets.size()) * set.stride, 0.0f);
+  set.norms.resize(first + offsets.size());
+  set.names.resize(first + offsets.size());
+  bool isSucceeded = true;
+  #pragma omp parallel for reduction(&&: isSucceeded)
+  for (int i = 0; i < static_cast<int>(offsets.size()); i++) {
+    size_t k = first + static_cast<size_t>(i);
+    ProfileRecordView view;
+    float *values = &set.values[k * set.stride];
+    if (!parseProfileRecord(file, offsets[static_cast<size_t>(i)], view)
+        || !resampleProfileRecord(view, param.nPoints, values)) {
+      #pragma omp critical(readOutput)
+      std::cerr << "Invalid record: " << filename << ": " << i << std::endl;
+      isSucceeded = false;
+      continue;
+    }
+    if (param.isNormalize) {
+      normalizeProfile(values, param.nPoints);
+    }
+    std::memcpy(values + param.nPoints, values, sizeof(float) * static_cast<size_t>(param.nPoints));
+    double sumSquares = 0.0;
+    REP_I (j, param.nPoints) {
+      sumSquares += static_cast<double>(values[j]) * static_cast<double>(values[j]);
+    }
+    set.norms[k] = static_cast<float>(std::sqrt(sumSquares));
+    set.names[k].assign(view.name, view.nameLength);
+  }
+  set.nProfiles += static_cast<int>(offsets.size());
+  closeMappedFile(file);
+  return isSucceeded;
+}
+
+
+/*!
+ * @brief Calculate the distance matrix and write it into the file mapped into
+ *        memory
+ *
+ * The upper triangle of the matrix is divided into tiles of TILE_SIZE x
+ * TILE_SIZE pairs, so that the profiles of a tile stay in the cache while
+ * the pairs are calculated, and the tiles are assigned to the threads
+ * dynamically.  Each distance is written to both (i, j) and (j, i).
+ *
+ *   Header (32 bytes)
+ *     char[8]   magic "EVDMAT\0\0"
+ *     uint32    version
+ *     uint32    reserved (0)
+ *     uint64    the number of profiles N
+ *     uint64    offset of the names
+ *   float32[]   N x N distances in row-major order
+ *   Names (aligned to 8 bytes)
+ *     uint32    length of the name
+ *     char[]    name
+ *
+ * @param [in] set    Profiles which are resampled
+ * @param [in] param  Parameters of this program
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+writeMatrix(const ProfileSet &set, const Param &param)
+{
+  size_t n = static_cast<size_t>(set.nProfiles);
+  size_t namesOffset = alignProfileSize(MATRIX_HEADER_SIZE + sizeof(float) * n * n);
+  size_t size = namesOffset;
+  REP (i, n) {
+    size += 4 + set.names[i].size();
+  }
+  WritableMappedFile file;
+  if (!createMappedFile(file, param.dstFilename, size)) {
+    return false;
+  }
+
+  std::memcpy(file.data, MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+  putLe32(file.data + 8, MATRIX_VERSION);
+  putLe32(file.data + 12, 0);
+  putLe64(file.data + 16, n);
+  putLe64(file.data + 24, namesOffset);
+  unsigned char *matrix = file.data + MATRIX_HEADER_SIZE;
+  std::memset(file.data + MATRIX_HEADER_SIZE + sizeof(float) * n * n, 0, namesOffset - MATRIX_HEADER_SIZE - sizeof(float) * n * n);
+  unsigned char *p = file.data + namesOffset;
+  REP (i, n) {
+    putLe32(p, static_cast<unsigned long>(set.names[i].size()));
+    std::memcpy(p + 4, set.names[i].data(), set.names[i].size());
+    p += 4 + set.names[i].size();
+  }
+
+  int nTiles = (set.nProfiles + TILE_SIZE - 1) / TILE_SIZE;
+  std::vector<std::pair<int, int> > tiles;
+  REP_I (ti, nTiles) {
+    FOR (tj, ti, nTiles) {
+      tiles.push_back(std::make_pair(ti, tj));
+    }
+  }
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (int t = 0; t < static_cast<int>(tiles.size()); t++) {
+    int i0 = tiles[static_cast<size_t>(t)].first * TILE_SIZE;
+    int j0 = tiles[static_cast<size_t>(t)].second * TILE_SIZE;
+    int i1 = std::min(i0 + TILE_SIZE, set.nProfiles);
+    int j1 = std::min(j0 + TILE_SIZE, set.nProfiles);
+    for (int i = i0; i < i1; i++) {
+      size_t row = static_cast<size_t>(i) * n;
+      for (int j = std::max(j0, i); j < j1; j++) {
+        float distance = i == j ? 0.0f : calcShapeDistance(set, i, j, param.shiftStep);
+        putLeFloat(matrix + sizeof(float) * (row + static_cast<size_t>(j)), distance);
+        putLeFloat(matrix + sizeof(float) * (static_cast<size_t>(j) * n + static_cast<size_t>(i)), distance);
+      }
+    }
+  }
+  return closeWritableMappedFile(file);
+}
+
+
+/*!
+ * @brief Calculate the K nearest profiles of each profile and write them in
+ *        csv-format
+ *
+ * The profiles are divided into tiles, and only the pairs of the tiles in the
+ * upper triangle are compared, so that the distance of each pair is
+ * calculated once and offered to the candidates of the both profiles.  The
+ * K nearest candidates of each profile are kept in a max-heap, and a pair
+ * whose lower bound of the distance, the difference of the norms, is not
+ * less than the K-th candidates of the both profiles is skipped.
+ * The tiles of rows are processed in order, and the pairs of a tile of rows
+ * and the following tiles of columns are compared in parallel.  The
+ * candidates of the rows are collected separately for each tile of columns
+ * and merged after them, so that the heaps are updated without any lock.
+ * Since the pairs with the preceding tiles are already compared, each tile
+ * of rows is written as soon as it is finished.
+ * @param [in] fp     File pointer of output
+ * @param [in] set    Profiles which are resampled
+ * @param [in] param  Parameters of this program
+ */
+static void
+writeNeighbors(std::FILE *fp, const ProfileSet &set, const Param &param)
+{
+  int nTiles = (set.nProfiles + TILE_SIZE - 1) / TILE_SIZE;
+  size_t k = static_cast<size_t>(std::min(param.topK, set.nProfiles - 1));
+  float scale = 1.0f / std::sqrt(static_cast<float>(set.nPoints));
+  std::vector<std::vector<Neighbor> > heaps(static_cast<size_t>(set.nProfiles));
+  for (int ti = 0; ti < nTiles; ti++) {
+    int i0 = ti * TILE_SIZE;
+    int i1 = std::min(i0 + TILE_SIZE, set.nProfiles);
+    size_t nRows = static_cast<size_t>(i1 - i0);
+    std::vector<std::vector<Neighbor> > candidates(static_cast<size_t>(nTiles - ti) * nRows);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int tj = ti; tj < nTiles; tj++) {
+      int j0 = tj * TILE_SIZE;
+      int j1 = std::min(j0 + TILE_SIZE, set.nProfiles);
+      // The heaps of the rows are only read here, and the candidates of the diagonal tile are also kept separately
+      std::vector<Neighbor> *rowHeaps = &candidates[static_cast<size_t>(tj - ti) * nRows];
+      for (int i = i0; i < i1; i++) {
+        std::vector<Neighbor> &rowHeap = rowHeaps[i - i0];
+        float rowLimit = std::min(getHeapLimit(rowHeap, k), getHeapLimit(heaps[static_cast<size_t>(i)], k));
+        for (int j = std::max(j0, i + 1); j < j1; j++) {
+          std::vector<Neighbor> &columnHeap = tj == ti ? rowHeaps[j - i0] : heaps[static_cast<size_t>(j)];
+          float columnLimit = tj == ti
+            ? std::min(getHeapLimit(columnHeap, k), getHeapLimit(heaps[static_cast<size_t>(j)], k))
+            : getHeapLimit(columnHeap, k);
+          float bound = std::fabs(set.norms[static_cast<size_t>(i)] - set.norms[static_cast<size_t>(j)]) * scale;
+          if (bound >= rowLimit && bound >= columnLimit) {
+            continue;
+          }
+          float distance = calcShapeDistance(set, i, j, param.shiftStep);
+          pushNeighbor(rowHeap, k, Neighbor(distance, static_cast<unsigned int>(j)));
+          pushNeighbor(columnHeap, k, Neighbor(distance, static_cast<unsigned int>(i)));
+          rowLimit = std::min(rowLimit, getHeapLimit(rowHeap, k));
+        }
+      }
+    }
+    for (int i = i0; i < i1; i++) {
+      std::vector<Neighbor> &heap = heaps[static_cast<size_t>(i)];
+      for (size_t t = 0; t < candidates.size(); t += nRows) {
+        FOREACH (neighbor, candidates[t + static_cast<size_t>(i - i0)]) {
+          pushNeighbor(heap, k, *neighbor);
+        }
+      }
+      std::sort_heap(heap.begin(), heap.end());
+      const std::string &name = set.names[static_cast<size_t>(i)];
+      REP (r, heap.size()) {
+        std::fprintf(fp, "%s,%lu,%s,%f\n",
+            name.c_str(),
+            static_cast<unsigned long>(r + 1),
+            set.names[static_cast<size_t>(heap[r].second)].c_str(),
+            heap[r].first);
+      }
+      std::vector<Neighbor>().swap(heap);
+    }
+  }
+}
+
+
+/*!
+ * @brief Calculate the distance between two profiles which is invariant to
+ *        the rotation
+ *
+ * The distance is the root mean square of the differences of the distances
+ * at the rotation which minimizes it.  The rotations are tried by shifting
+ * the window over the copied profile of j.
+ * @param [in] set        Profiles which are resampled
+ * @param [in] i          Index of a profile
+ * @param [in] j          Index of the other profile
+ * @param [in] shiftStep  Step of the rotations in the number of angles
+ * @return  The distance
+ */
+ATTR_NOTHROW static float
+calcShapeDistance(const ProfileSet &set, int i, int j, int shiftStep) noexcept
+{
+  const float *a = &set.values[static_cast<size_t>(i) * set.stride];
+  const float *b = &set.values[static_cast<size_t>(j) * set.stride];
+  float minSum = sumSquaredDiff(a, b, set.nPoints);
+  for (int s = shiftStep; s < set.nPoints; s += shiftStep) {
+    minSum = std::min(minSum, sumSquaredDiff(a, b + s, set.nPoints));
+  }
+  return std::sqrt(minSum / static_cast<float>(set.nPoints));
+}
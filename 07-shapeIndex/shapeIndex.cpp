@@ -0,0 +1,1092 @@
+/*!
+ * @brief Build the index of the shape descriptors of the profiles which
+ *        evalArea writes, and find the nearest shapes with it
+ *
+ * The descriptor of each record is the Fourier descriptor which evalArea
+ * writes with --fourier, or the profile which is resampled to the same
+ * number of angles and divided by its mean.  The descriptors are indexed by
+ * a vantage-point tree for the exact search, or encoded by product
+ * quantization for the approximate search over the compact codes.  The
+ * index file is referred to directly from the memory which it is mapped
+ * into, so that a query does not need to load the whole index.
+ *
+ * @author  koturn 0;
+ * @file    shapeIndex.cpp
+ */
+#include <gccUtil/nowarnings.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#include <commonUtil/compat.h>
+#include <commonUtil/foreach.h>
+#include <gccUtil/restorewarnings.h>
+
+#include "../util/include/distanceUtil.h"
+#include "../util/include/mmapUtil.h"
+#include "../util/include/neighborUtil.h"
+#include "../util/include/profileUtil.h"
+#include "../util/include/timeUtil.h"
+
+
+//! Descriptors of the records
+typedef enum {
+  DESCRIPTOR_FOURIER,  //!< Fourier descriptor which evalArea writes with --fourier
+  DESCRIPTOR_PROFILE   //!< Resampled profile which is divided by its mean
+} DescriptorType;
+
+//! Types of the index
+typedef enum {
+  INDEX_TYPE_VPTREE,  //!< Vantage-point tree over the descriptors
+  INDEX_TYPE_PQ       //!< Flat array of the codes of product quantization
+} IndexType;
+
+//! The structre of parameters for this program
+typedef struct {
+  const char     *dstFilename;     //!< A name of output index file, or csv-file of the query
+  const char     *queryFilename;   //!< A name of binary profile file of the queries (nullptr means building)
+  char *const    *srcFilenames;    //!< Names of binary profile files, or the index file of the query
+  int             nSrcFiles;       //!< The number of srcFilenames
+  DescriptorType  descriptorType;  //!< Descriptor of the records
+  int             nPoints;         //!< The number of angles to resample each profile to
+  int             nSubvectors;     //!< The number of subvectors of product quantization (0 means VP-tree)
+  int             topK;            //!< The number of the nearest records to write
+} Param;
+
+static const char     INDEX_MAGIC[8]    = {'E', 'V', 'S', 'I', 'D', 'X', '\0', '\0'};  //!< Magic of the index file
+static const unsigned INDEX_VERSION     = 1;      //!< Version of the format of the index file
+static const size_t   INDEX_HEADER_SIZE = 64;     //!< Size of the header of the index file
+static const size_t   VPTREE_LEAF_SIZE  = 16;     //!< The maximum number of descriptors in a leaf of VP-tree
+static const size_t   PARALLEL_MIN_SIZE = 4096;   //!< The minimum number of descriptors to calculate in parallel
+static const int      PQ_N_CENTROIDS    = 256;    //!< The number of centroids of each subvector
+static const int      PQ_N_ITERATIONS   = 16;     //!< The number of iterations of k-means
+static const size_t   PQ_MAX_SAMPLES    = 65536;  //!< The maximum number of descriptors to train the centroids
+
+//! Descriptors of the records
+struct DescriptorSet {
+  size_t                   nDescriptors;  //!< The number of descriptors
+  int                      nDims;         //!< The number of dimensions of each descriptor
+  std::vector<float>       values;        //!< Values of all descriptors
+  std::vector<std::string> names;         //!< Names of the records
+
+  DescriptorSet() :
+    nDescriptors(0),
+    nDims(0),
+    values(),
+    names()
+  {}
+};
+
+//! The index file which is mapped into memory
+typedef struct {
+  IndexType                 type;            //!< Type of the index
+  DescriptorType            descriptorType;  //!< Descriptor of the records
+  int                       nDims;           //!< The number of dimensions of each descriptor
+  int                       nPoints;         //!< The number of angles of the resampled profile
+  int                       nSubvectors;     //!< The number of subvectors of product quantization
+  size_t                    leafSize;        //!< The maximum number of descriptors in a leaf of VP-tree
+  size_t                    nEntries;        //!< The number of records
+  const unsigned int       *ids;             //!< Indices of the records in the order of VP-tree
+  const float              *radii;           //!< Radius of the vantage point of each node of VP-tree
+  const unsigned int       *mids;            //!< The first position of the outside of each node of VP-tree
+  const float              *vectors;         //!< Descriptors in the order of VP-tree
+  const float              *codebooks;       //!< Centroids of the subvectors of product quantization
+  const unsigned char      *codes;           //!< Codes of product quantization of the records
+  const unsigned long long *nameOffsets;     //!< Offsets of the names of the records
+  const unsigned char      *data;            //!< Address of the mapped index file
+  size_t                    size;            //!< Size of the mapped index file
+} IndexView;
+
+
+static Param
+parseArguments(int argc, char *argv[]);
+
+ATTR_NOTHROW ALWAYSINLINE static void
+showUsage(const char *progname) noexcept;
+
+static DescriptorType
+parseDescriptorType(const char *typeString);
+
+static bool
+buildIndexFile(const Param &param);
+
+static bool
+queryIndexFile(const Param &param);
+
+static bool
+readDescriptors(const char *filename, DescriptorType descriptorType, int nPoints, DescriptorSet &set);
+
+ATTR_NOTHROW static bool
+extractDescriptor(const ProfileRecordView &view, DescriptorType descriptorType, int nPoints, int nDims, float *descriptor) noexcept;
+
+static void
+buildVpTree(const DescriptorSet &set, std::vector<unsigned int> &ids, std::vector<float> &radii, std::vector<unsigned int> &mids);
+
+static void
+trainProductQuantizer(const DescriptorSet &set, int nSubvectors, std::vector<float> &codebooks);
+
+static void
+encodeProductQuantizer(const DescriptorSet &set, int nSubvectors, const std::vector<float> &codebooks, std::vector<unsigned char> &codes);
+
+ATTR_NOTHROW static int
+findNearestCentroid(const float *subvector, const float *centroids, int nDims) noexcept;
+
+static bool
+writeIndex(const char *filename, const DescriptorSet &set, const Param &param);
+
+static void
+parseIndex(const MappedFile &file, IndexView &index);
+
+static void
+validateVpTree(const IndexView &index);
+
+static void
+searchVpTree(const IndexView &index, const float *query, size_t lo, size_t hi, size_t k, std::vector<Neighbor> &heap);
+
+static void
+searchProductQuantizer(const IndexView &index, const float *query, size_t k, std::vector<Neighbor> &heap);
+
+ATTR_NOTHROW ALWAYSINLINE static float
+calcL2Distance(const float *a, const float *b, int nDims) noexcept;
+
+static std::string
+getIndexName(const IndexView &index, size_t i);
+
+ATTR_NOTHROW ALWAYSINLINE static bool
+isLittleEndian() noexcept;
+
+/*!
+ * @brief The entry point of this program
+ * @param [in] argc  A number of comand-line arguments
+ * @param [in] argv  Command-line arguments.
+ * @return  exit-status
+ */
+int
+main(int argc, char *argv[])
+{
+  Param param;
+  try {
+    param = parseArguments(argc, argv);
+  } catch (const char *errmsg) {
+    std::cerr << "ERROR: " << errmsg << std::endl;
+    showUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  bool isSucceeded = param.queryFilename == nullptr ? buildIndexFile(param) : queryIndexFile(param);
+  return isSucceeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*!
+ * @brief Parse comamnd-line arguments and set parameters.
+ *
+ * 'argv' is sorted after called getopt_long().
+ * @param [in]     argc  A number of command-line arguments
+ * @param [in,out] argv  Coomand-line arguments
+ * @return Parameter structure of this program.
+ */
+static Param
+parseArguments(int argc, char *argv[])
+{
+  static const struct option opts[] = {
+    {"descriptor", required_argument, nullptr, 0},
+    {"points",     required_argument, nullptr, 1},
+    {"pq",         required_argument, nullptr, 2},
+    {"query",      required_argument, nullptr, 3},
+    {"help",       no_argument,       nullptr, 'h'},
+    {"top-k",      required_argument, nullptr, 'k'},
+    {"output",     required_argument, nullptr, 'o'},
+    {0, 0, 0, 0}   // must be filled with zero
+  };
+
+  int ret;
+  int optidx;
+  Param param = {
+    nullptr,
+    nullptr,
+    nullptr,
+    0,
+    DESCRIPTOR_FOURIER,
+    64,
+    0,
+    10
+  };
+  while ((ret = getopt_long(argc, argv, "hk:o:", opts, &optidx)) != -1) {
+    switch (ret) {
+      case 0:    // --descriptor
+        param.descriptorType = parseDescriptorType(optarg);
+        break;
+      case 1:    // --points
+        if (std::sscanf(optarg, "%d", &param.nPoints) != 1) {
+          throw "Invalid option argument: --points";
+        }
+        if (param.nPoints <= 0) {
+          throw "Invalid value for option argument: --points (must be positive)";
+        }
+        break;
+      case 2:    // --pq
+        if (std::sscanf(optarg, "%d", &param.nSubvectors) != 1) {
+          throw "Invalid option argument: --pq";
+        }
+        if (param.nSubvectors <= 0) {
+          throw "Invalid value for option argument: --pq (must be positive)";
+        }
+        break;
+      case 3:    // --query
+        param.queryFilename = optarg;
+        break;
+      case 'h':  // -h or --help
+        showUsage(argv[0]);
+        std::exit(EXIT_SUCCESS);
+      case 'k':  // -k or --top-k
+        if (std::sscanf(optarg, "%d", &param.topK) != 1) {
+          throw "Invalid option argument: -k, --top-k";
+        }
+        if (param.topK <= 0) {
+          throw "Invalid value for option argument: -k, --top-k (must be positive)";
+        }
+        break;
+      case 'o':  // -o or --output
+        param.dstFilename = optarg;
+        break;
+      case '?':  // unknown option
+        showUsage(argv[0]);
+        std::exit(EXIT_FAILURE);
+    }
+  }
+  if (param.queryFilename == nullptr) {
+    if (optind >= argc) {
+      throw "Invalid arguments";
+    }
+    if (param.dstFilename == nullptr) {
+      throw "Output index file must be specified with -o, --output";
+    }
+  } else if (optind != argc - 1) {
+    throw "Invalid arguments";
+  }
+  param.srcFilenames = argv + optind;
+  param.nSrcFiles    = argc - optind;
+  return param;
+}
+
+
+/*!
+ * @brief Show an usage of this program.
+ * @param [in] progname  A name of this program
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+showUsage(const char *progname) noexcept
+{
+  std::cout << "[Usage]\n"
+            << "  $ " << progname << " PROFILE-FILE... -o INDEX-FILE [options]\n"
+            << "  $ " << progname << " INDEX-FILE --query=PROFILE-FILE [options]\n\n"
+               "[options]\n"
+               "  -h, --help\n"
+               "    show help and exit\n"
+               "  -k K, --top-k=K\n"
+               "    Write the K nearest records of each query\n"
+               "      DEFAULT_VALUE = 10\n"
+               "  -o FILENAME, --output=FILENAME\n"
+               "    Specify output index file name (required without --query)\n"
+               "    With --query, specify output csv-file name (default: stdout)\n"
+               "  --descriptor=TYPE\n"
+               "    Specify descriptor of the records to index\n"
+               "      - fourier: Fourier descriptor which evalArea writes with --fourier\n"
+               "      - profile: Resampled profile divided by its mean\n"
+               "      DEFAULT_VALUE = fourier\n"
+               "  --points=M\n"
+               "    Resample each profile to M angles for --descriptor=profile\n"
+               "      DEFAULT_VALUE = 64\n"
+               "  --pq=M\n"
+               "    Encode the descriptors with product quantization of M subvectors\n"
+               "    instead of building VP-tree (approximate search)\n"
+               "  --query=FILENAME\n"
+               "    Find the nearest records of each record of the profile file FILENAME"
+            << std::endl;
+}
+
+
+/*!
+ * @brief Parse the descriptor of the records
+ * @param [in] typeString  A string of the descriptor ("fourier" or "profile")
+ * @return  The descriptor
+ */
+static DescriptorType
+parseDescriptorType(const char *typeString)
+{
+  if (!std::strcmp(typeString, "fourier")) {
+    return DESCRIPTOR_FOURIER;
+  } else if (!std::strcmp(typeString, "profile")) {
+    return DESCRIPTOR_PROFILE;
+  } else {
+    throw "Invalid option argument: --descriptor";
+  }
+}
+
+
+/*!
+ * @brief Read the descriptors of all records of the profile files, build the
+ *        index and write it
+ * @param [in] param  Parameters of this program
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+buildIndexFile(const Param &param)
+{
+  DescriptorSet set;
+  if (param.descriptorType == DESCRIPTOR_PROFILE) {
+    set.nDims = param.nPoints;
+  }
+  REP_I (i, param.nSrcFiles) {
+    if (!readDescriptors(param.srcFilenames[i], param.descriptorType, param.nPoints, set)) {
+      return false;
+    }
+  }
+  if (set.nDescriptors == 0) {
+    std::cerr << "No profile is found" << std::endl;
+    return false;
+  }
+  if (param.nSubvectors > set.nDims) {
+    std::cerr << "The number of subvectors exceeds the dimensions of the descriptor: " << set.nDims << std::endl;
+    return false;
+  }
+
+#ifdef _OPENMP
+  int nThreads = omp_get_max_threads();
+#else
+  int nThreads = 1;
+#endif
+  double t0 = getSeconds();
+  if (!writeIndex(param.dstFilename, set, param)) {
+    std::cerr << "Failed to write index file: " << param.dstFilename << std::endl;
+    return false;
+  }
+  double elapsed = getSeconds() - t0;
+  std::fprintf(stderr, "%lu records (%d dimensions) indexed in %f s with %d threads\n",
+      static_cast<unsigned long>(set.nDescriptors), set.nDims, elapsed, nThreads);
+  return true;
+}
+
+
+/*!
+ * @brief Find the nearest records of each record of the query file with the
+ *        index and write them in csv-format
+ *
+ * The queries are processed in parallel, and written in order.
+ * @param [in] param  Parameters of this program
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+queryIndexFile(const Param &param)
+{
+  const char *indexFilename = param.srcFilenames[0];
+  MappedFile file;
+  if (!openMappedFile(file, indexFilename)) {
+    std::cerr << "Failed to open index file: " << indexFilename << std::endl;
+    return false;
+  }
+  IndexView index;
+  try {
+    parseIndex(file, index);
+  } catch (const char *errmsg) {
+    std::cerr << "Invalid index file: " << indexFilename << " (" << errmsg << ")" << std::endl;
+    closeMappedFile(file);
+    return false;
+  }
+  DescriptorSet queries;
+  queries.nDims = index.nDims;
+  if (!readDescriptors(param.queryFilename, index.descriptorType, index.nPoints, queries)) {
+    closeMappedFile(file);
+    return false;
+  }
+  std::FILE *fp = param.dstFilename == nullptr ? stdout : std::fopen(param.dstFilename, "w");
+  if (fp == nullptr) {
+    std::cerr << "Failed to open file: " << param.dstFilename << std::endl;
+    closeMappedFile(file);
+    return false;
+  }
+
+#ifdef _OPENMP
+  int nThreads = omp_get_max_threads();
+#else
+  int nThreads = 1;
+#endif
+  size_t k = std::min(static_cast<size_t>(param.topK), index.nEntries);
+  double t0 = getSeconds();
+  #pragma omp parallel for ordered schedule(dynamic, 1)
+  for (int i = 0; i < static_cast<int>(queries.nDescriptors); i++) {
+    const float *query = &queries.values[static_cast<size_t>(i) * static_cast<size_t>(queries.nDims)];
+    std::vector<Neighbor> heap;
+    heap.reserve(k);
+    if (index.type == INDEX_TYPE_VPTREE) {
+      searchVpTree(index, query, 0, index.nEntries, k, heap);
+    } else {
+      searchProductQuantizer(index, query, k, heap);
+    }
+    std::sort_heap(heap.begin(), heap.end());
+    #pragma omp ordered
+    REP (r, heap.size()) {
+      std::fprintf(fp, "%s,%lu,%s,%f\n",
+          queries.names[static_cast<size_t>(i)].c_str(),
+          static_cast<unsigned long>(r + 1),
+          getIndexName(index, heap[r].second).c_str(),
+          heap[r].first);
+    }
+  }
+  double elapsed = getSeconds() - t0;
+
+  if (fp != stdout) {
+    std::fclose(fp);
+  }
+  closeMappedFile(file);
+  std::fprintf(stderr, "%lu queries over %lu records in %f s with %d threads: %f ms/query\n",
+      static_cast<unsigned long>(queries.nDescriptors), static_cast<unsigned long>(index.nEntries), elapsed, nThreads,
+      queries.nDescriptors > 0 ? 1000.0 * elapsed / static_cast<double>(queries.nDescriptors) : 0.0);
+  return true;
+}
+
+
+/*!
+ * @brief Read the descriptors of all records of the profile file and append
+ *        them to the set
+ *
+ * If the number of dimensions of the set is zero, it is taken from the first
+ * record.
+ * @param [in]     filename        A name of binary profile file
+ * @param [in]     descriptorType  Descriptor of the records
+ * @param [in]     nPoints         The number of angles to resample each profile to
+ * @param [in,out] set             Descriptors of the records
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+readDescriptors(const char *filename, DescriptorType descriptorType, int nPoints, DescriptorSet &set)
+{
+  MappedFile file;
+  if (!openMappedFile(file, filename)) {
+    std::cerr << "Failed to open profile file: " << filename << std::endl;
+    return false;
+  }
+  std::vector<unsigned long long> offsets;
+  if (!listProfileRecords(file, filename, offsets)) {
+    std::cerr << "Invalid profile file: " << filename << std::endl;
+    closeMappedFile(file);
+    return false;
+  }
+  ProfileRecordView first;
+  if (set.nDims == 0 && !offsets.empty() && parseProfileRecord(file, offsets[0], first)) {
+    set.nDims = static_cast<int>(first.nScalars) - PROFILE_N_SCALARS;
+    if (set.nDims <= 0) {
+      std::cerr << "The records have no Fourier descriptor (use --fourier of evalArea): " << filename << std::endl;
+      closeMappedFile(file);
+      return false;
+    }
+  }
+
+  size_t nDims = static_cast<size_t>(set.nDims);
+  size_t base  = set.nDescriptors;
+  set.values.resize((base + offsets.size()) * nDims);
+  set.names.resize(base + offsets.size());
+  bool isSucceeded = true;
+  #pragma omp parallel for reduction(&&: isSucceeded)
+  for (int i = 0; i < static_cast<int>(offsets.size()); i++) {
+    size_t k = base + static_cast<size_t>(i);
+    ProfileRecordView view;
+    if (!parseProfileRecord(file, offsets[static_cast<size_t>(i)], view)
+        || !extractDescriptor(view, descriptorType, nPoints, set.nDims, &set.values[k * nDims])) {
+      #pragma omp critical(readOutput)
+      std::cerr << "Invalid record: " << filename << ": " << i << std::endl;
+      isSucceeded = false;
+      continue;
+    }
+    set.names[k].assign(view.name, view.nameLength);
+  }
+  set.nDescriptors += offsets.size();
+  closeMappedFile(file);
+  return isSucceeded;
+}
+
+
+/*!
+ * @brief Extract the descriptor of the record
+ *
+ * The Fourier descriptor must have the same number of coefficients as the
+ * dimensions.  The profile is resampled and divided by its mean, so that the
+ * descriptor is invariant to the size of the shape as the Fourier descriptor.
+ * @param [in]  view            A record
+ * @param [in]  descriptorType  Descriptor of the records
+ * @param [in]  nPoints         The number of angles to resample the profile to
+ * @param [in]  nDims           The number of dimensions of the descriptor
+ * @param [out] descriptor      The descriptor (nDims values)
+ * @return  true if the record has the descriptor, otherwise false
+ */
+ATTR_NOTHROW static bool
+extractDescriptor(const ProfileRecordView &view, DescriptorType descriptorType, int nPoints, int nDims, float *descriptor) noexcept
+{
+  switch (descriptorType) {
+    case DESCRIPTOR_FOURIER:
+      if (view.nScalars != static_cast<size_t>(PROFILE_N_SCALARS + nDims)) {
+        return false;
+      }
+      REP_I (i, nDims) {
+        descriptor[i] = static_cast<float>(getProfileScalar(view, static_cast<size_t>(PROFILE_N_SCALARS + i)));
+      }
+      return true;
+    case DESCRIPTOR_PROFILE:
+      if (!resampleProfileRecord(view, nPoints, descriptor)) {
+        return false;
+      }
+      normalizeProfile(descriptor, nPoints);
+      return true;
+  }
+  return false;
+}
+
+
+/*!
+ * @brief Build VP-tree over the descriptors
+ *
+ * The tree is laid out in an array implicitly.  The node of the range
+ * [lo, hi) has the vantage point at lo, the inside [lo + 1, mid) whose
+ * distances from the vantage point are not greater than the radius, and the
+ * outside [mid, hi) whose distances are not less than the radius, where mid
+ * is the median.  The range of VPTREE_LEAF_SIZE descriptors or less is a
+ * leaf which is scanned linearly.
+ * @param [in]  set    Descriptors of the records
+ * @param [out] ids    Indices of the records in the order of the tree
+ * @param [out] radii  Radius of each node
+ * @param [out] mids   The first position of the outside of each node
+ */
+static void
+buildVpTree(const DescriptorSet &set, std::vector<unsigned int> &ids, std::vector<float> &radii, std::vector<unsigned int> &mids)
+{
+  size_t n = set.nDescriptors;
+  std::vector<Neighbor> items(n);
+  REP (i, n) {
+    items[i] = Neighbor(0.0f, static_cast<unsigned int>(i));
+  }
+  radii.assign(n, 0.0f);
+  mids.assign(n, 0);
+
+  std::vector<std::pair<size_t, size_t> > stack(1, std::make_pair(static_cast<size_t>(0), n));
+  while (!stack.empty()) {
+    size_t lo = stack.back().first;
+    size_t hi = stack.back().second;
+    stack.pop_back();
+    if (hi - lo <= VPTREE_LEAF_SIZE) {
+      continue;
+    }
+    // The middle element is taken as the vantage point, since the records are in arbitrary order
+    std::swap(items[lo], items[lo + (hi - lo) / 2]);
+    const float *vantage = &set.values[static_cast<size_t>(items[lo].second) * static_cast<size_t>(set.nDims)];
+    #pragma omp parallel for if (hi - lo >= PARALLEL_MIN_SIZE)
+    for (int i = static_cast<int>(lo + 1); i < static_cast<int>(hi); i++) {
+      Neighbor &item = items[static_cast<size_t>(i)];
+      item.first = calcL2Distance(vantage, &set.values[static_cast<size_t>(item.second) * static_cast<size_t>(set.nDims)], set.nDims);
+    }
+    size_t mid = lo + 1 + (hi - lo - 1) / 2;
+    std::nth_element(items.begin() + static_cast<std::ptrdiff_t>(lo + 1), items.begin() + static_cast<std::ptrdiff_t>(mid), items.begin() + static_cast<std::ptrdiff_t>(hi));
+    radii[lo] = items[mid].first;
+    mids[lo]  = static_cast<unsigned int>(mid);
+    stack.push_back(std::make_pair(lo + 1, mid));
+    stack.push_back(std::make_pair(mid, hi));
+  }
+  ids.resize(n);
+  REP (i, n) {
+    ids[i] = items[i].second;
+  }
+}
+
+
+/*!
+ * @brief Train the centroids of each subvector of product quantization by
+ *        k-means
+ *
+ * The descriptor of D dimensions is divided into M subvectors, and the j-th
+ * subvector has the dimensions [D * j / M, D * (j + 1) / M).  The centroids
+ * are trained with up to PQ_MAX_SAMPLES descriptors which are taken at even
+ * intervals, and initialized with the samples at even intervals.
+ * @param [in]  set          Descriptors of the records
+ * @param [in]  nSubvectors  The number of subvectors M
+ * @param [out] codebooks    PQ_N_CENTROIDS centroids of each subvector, where the
+ *                           centroids of the j-th subvector start at PQ_N_CENTROIDS * (D * j / M)
+ */
+static void
+trainProductQuantizer(const DescriptorSet &set, int nSubvectors, std::vector<float> &codebooks)
+{
+  size_t nDims    = static_cast<size_t>(set.nDims);
+  size_t nSamples = std::min(set.nDescriptors, PQ_MAX_SAMPLES);
+  std::vector<size_t> samples(nSamples);
+  REP (i, nSamples) {
+    samples[i] = i * set.nDescriptors / nSamples;
+  }
+  codebooks.assign(static_cast<size_t>(PQ_N_CENTROIDS) * nDims, 0.0f);
+
+  std::vector<int> labels(nSamples);
+  REP_I (j, nSubvectors) {
+    size_t d0 = nDims * static_cast<size_t>(j) / static_cast<size_t>(nSubvectors);
+    size_t d1 = nDims * static_cast<size_t>(j + 1) / static_cast<size_t>(nSubvectors);
+    size_t subDims = d1 - d0;
+    float *centroids = &codebooks[static_cast<size_t>(PQ_N_CENTROIDS) * d0];
+    REP_I (c, PQ_N_CENTROIDS) {
+      const float *sample = &set.values[samples[static_cast<size_t>(c) * nSamples / PQ_N_CENTROIDS] * nDims + d0];
+      std::copy(sample, sample + subDims, centroids + static_cast<size_t>(c) * subDims);
+    }
+    REP_I (iteration, PQ_N_ITERATIONS) {
+      #pragma omp parallel for
+      for (int i = 0; i < static_cast<int>(nSamples); i++) {
+        labels[static_cast<size_t>(i)] = findNearestCentroid(&set.values[samples[static_cast<size_t>(i)] * nDims + d0], centroids, static_cast<int>(subDims));
+      }
+      std::vector<double> sums(static_cast<size_t>(PQ_N_CENTROIDS) * subDims, 0.0);
+      std::vector<size_t> counts(static_cast<size_t>(PQ_N_CENTROIDS), 0);
+      REP (i, nSamples) {
+        size_t label = static_cast<size_t>(labels[i]);
+        const float *sample = &set.values[samples[i] * nDims + d0];
+        REP (d, subDims) {
+          sums[label * subDims + d] += sample[d];
+        }
+        counts[label]++;
+      }
+      // The centroid which has no sample is left as it is
+      REP (c, counts.size()) {
+        if (counts[c] == 0) {
+          continue;
+        }
+        REP (d, subDims) {
+          centroids[c * subDims + d] = static_cast<float>(sums[c * subDims + d] / static_cast<double>(counts[c]));
+        }
+      }
+    }
+  }
+}
+
+
+/*!
+ * @brief Encode the descriptors into the codes of product quantization
+ * @param [in]  set          Descriptors of the records
+ * @param [in]  nSubvectors  The number of subvectors M
+ * @param [in]  codebooks    Centroids of each subvector
+ * @param [out] codes        M codes of each record
+ */
+static void
+encodeProductQuantizer(const DescriptorSet &set, int nSubvectors, const std::vector<float> &codebooks, std::vector<unsigned char> &codes)
+{
+  size_t nDims = static_cast<size_t>(set.nDims);
+  size_t m     = static_cast<size_t>(nSubvectors);
+  codes.resize(set.nDescriptors * m);
+  #pragma omp parallel for
+  for (int i = 0; i < static_cast<int>(set.nDescriptors); i++) {
+    const float *descriptor = &set.values[static_cast<size_t>(i) * nDims];
+    REP (j, m) {
+      size_t d0 = nDims * j / m;
+      size_t d1 = nDims * (j + 1) / m;
+      codes[static_cast<size_t>(i) * m + j] = static_cast<unsigned char>(
+          findNearestCentroid(descriptor + d0, &codebooks[static_cast<size_t>(PQ_N_CENTROIDS) * d0], static_cast<int>(d1 - d0)));
+    }
+  }
+}
+
+
+/*!
+ * @brief Find the nearest centroid of the subvector
+ * @param [in] subvector  A subvector
+ * @param [in] centroids  PQ_N_CENTROIDS centroids of the subvector
+ * @param [in] nDims      The number of dimensions of the subvector
+ * @return  Index of the nearest centroid
+ */
+ATTR_NOTHROW static int
+findNearestCentroid(const float *subvector, const float *centroids, int nDims) noexcept
+{
+  int nearest = 0;
+  float minDistance = std::numeric_limits<float>::max();
+  REP_I (c, PQ_N_CENTROIDS) {
+    float distance = sumSquaredDiff(subvector, centroids + c * nDims, nDims);
+    if (distance < minDistance) {
+      minDistance = distance;
+      nearest = c;
+    }
+  }
+  return nearest;
+}
+
+
+/*!
+ * @brief Build the index and write it into the file mapped into memory
+ *
+ * All values are little-endian and every section is aligned to 8 bytes.
+ *
+ *   Header (64 bytes)
+ *     char[8]    magic "EVSIDX\0\0"
+ *     uint32     version
+ *     uint32     type of the index (0: VP-tree, 1: product quantization)
+ *     uint32     descriptor (0: fourier, 1: profile)
+ *     uint32     the number of dimensions D
+ *     uint64     the number of records N
+ *     uint32     the number of angles of the resampled profile (0 for fourier)
+ *     uint32     the number of subvectors M (0 for VP-tree)
+ *     uint64     offset of the data
+ *     uint64     offset of the names
+ *     uint32     the maximum number of descriptors in a leaf of VP-tree
+ *     uint32     reserved (0)
+ *   Data of VP-tree
+ *     uint32[N]     indices of the records in the order of the tree
+ *     float32[N]    radius of each node
+ *     uint32[N]     the first position of the outside of each node
+ *     float32[N][D] descriptors in the order of the tree
+ *   Data of product quantization
+ *     float32[256 * D]  centroids of each subvector
+ *     uint8[N][M]       codes of each record
+ *   Names
+ *     uint64[N]  offsets of the names
+ *     uint32     length of the name, followed by the name, for each record
+ *
+ * @param [in] filename  A name of the index file
+ * @param [in] set       Descriptors of the records
+ * @param [in] param     Parameters of this program
+ * @return  true if succeeded, otherwise false
+ */
+static bool
+writeIndex(const char *filename, const DescriptorSet &set, const Param &param)
+{
+  size_t n     = set.nDescriptors;
+  size_t nDims = static_cast<size_t>(set.nDims);
+  size_t m     = static_cast<size_t>(param.nSubvectors);
+  size_t arraySize = alignProfileSize(sizeof(unsigned int) * n);
+
+  std::vector<unsigned int>  ids;
+  std::vector<float>         radii;
+  std::vector<unsigned int>  mids;
+  std::vector<float>         codebooks;
+  std::vector<unsigned char> codes;
+  size_t dataSize;
+  if (param.nSubvectors == 0) {
+    buildVpTree(set, ids, radii, mids);
+    dataSize = 3 * arraySize + sizeof(float) * n * nDims;
+  } else {
+    trainProductQuantizer(set, param.nSubvectors, codebooks);
+    encodeProductQuantizer(set, param.nSubvectors, codebooks, codes);
+    dataSize = sizeof(float) * codebooks.size() + codes.size();
+  }
+  size_t namesOffset = INDEX_HEADER_SIZE + alignProfileSize(dataSize);
+  size_t size = namesOffset + sizeof(unsigned long long) * n;
+  REP (i, n) {
+    size += 4 + set.names[i].size();
+  }
+
+  WritableMappedFile file;
+  if (!createMappedFile(file, filename, size)) {
+    return false;
+  }
+  std::memset(file.data, 0, namesOffset);
+  std::memcpy(file.data, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  putLe32(file.data + 8, INDEX_VERSION);
+  putLe32(file.data + 12, param.nSubvectors == 0 ? INDEX_TYPE_VPTREE : INDEX_TYPE_PQ);
+  putLe32(file.data + 16, param.descriptorType);
+  putLe32(file.data + 20, static_cast<unsigned long>(nDims));
+  putLe64(file.data + 24, n);
+  putLe32(file.data + 32, param.descriptorType == DESCRIPTOR_PROFILE ? static_cast<unsigned long>(param.nPoints) : 0);
+  putLe32(file.data + 36, static_cast<unsigned long>(m));
+  putLe64(file.data + 40, INDEX_HEADER_SIZE);
+  putLe64(file.data + 48, namesOffset);
+  putLe32(file.data + 56, static_cast<unsigned long>(VPTREE_LEAF_SIZE));
+
+  unsigned char *data = file.data + INDEX_HEADER_SIZE;
+  if (param.nSubvectors == 0) {
+    #pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(n); i++) {
+      size_t k = static_cast<size_t>(i);
+      putLe32(data + 4 * k, ids[k]);
+      putLeFloat(data + arraySize + 4 * k, radii[k]);
+      putLe32(data + 2 * arraySize + 4 * k, mids[k]);
+      const float *descriptor = &set.values[static_cast<size_t>(ids[k]) * nDims];
+      REP (d, nDims) {
+        putLeFloat(data + 3 * arraySize + sizeof(float) * (k * nDims + d), descriptor[d]);
+      }
+    }
+  } else {
+    REP (i, codebooks.size()) {
+      putLeFloat(data + sizeof(float) * i, codebooks[i]);
+    }
+    std::memcpy(data + sizeof(float) * codebooks.size(), &codes[0], codes.size());
+  }
+
+  unsigned char *offsets = file.data + namesOffset;
+  size_t offset = namesOffset + sizeof(unsigned long long) * n;
+  REP (i, n) {
+    putLe64(offsets + sizeof(unsigned long long) * i, offset);
+    putLe32(file.data + offset, static_cast<unsigned long>(set.names[i].size()));
+    std::memcpy(file.data + offset + 4, set.names[i].data(), set.names[i].size());
+    offset += 4 + set.names[i].size();
+  }
+  return closeWritableMappedFile(file);
+}
+
+
+/*!
+ * @brief Parse the header of the mapped index file and set the addresses of
+ *        the sections
+ *
+ * The sections are referred to directly, so that the index file can be used
+ * only on little-endian machines.  The sizes of the sections and the nodes
+ * of VP-tree are checked, so that no search reads out of the file.
+ * @param [in]  file   The mapped index file
+ * @param [out] index  The parsed index
+ */
+static void
+parseIndex(const MappedFile &file, IndexView &index)
+{
+  if (!isLittleEndian()) {
+    throw "The index file can be used only on little-endian machines";
+  }
+  if (file.size < INDEX_HEADER_SIZE || std::memcmp(file.data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+      || getLe32(file.data + 8) != INDEX_VERSION) {
+    throw "Invalid header";
+  }
+  unsigned long type           = getLe32(file.data + 12);
+  unsigned long descriptorType = getLe32(file.data + 16);
+  unsigned long long n           = getLe64(file.data + 24);
+  unsigned long long dataOffset  = getLe64(file.data + 40);
+  unsigned long long namesOffset = getLe64(file.data + 48);
+  if (type > INDEX_TYPE_PQ || descriptorType > DESCRIPTOR_PROFILE) {
+    throw "Unknown type of the index or the descriptor";
+  }
+  if (n > 0xffffffffULL || dataOffset < INDEX_HEADER_SIZE || dataOffset % 8 != 0 || namesOffset % 8 != 0
+      || namesOffset < dataOffset || namesOffset > file.size
+      || n > (file.size - namesOffset) / sizeof(unsigned long long)) {
+    throw "The sections are out of the file";
+  }
+  index.type           = type == INDEX_TYPE_VPTREE ? INDEX_TYPE_VPTREE : INDEX_TYPE_PQ;
+  index.descriptorType = descriptorType == DESCRIPTOR_FOURIER ? DESCRIPTOR_FOURIER : DESCRIPTOR_PROFILE;
+  index.nDims          = static_cast<int>(getLe32(file.data + 20));
+  index.nEntries       = static_cast<size_t>(n);
+  index.nPoints        = static_cast<int>(getLe32(file.data + 32));
+  index.nSubvectors    = static_cast<int>(getLe32(file.data + 36));
+  index.leafSize       = static_cast<size_t>(getLe32(file.data + 56));
+  index.data           = file.data;
+  index.size           = file.size;
+  // The descriptors of the queries are extracted with the number of angles in the header
+  if (index.nDims <= 0
+      || (index.descriptorType == DESCRIPTOR_FOURIER && index.nPoints != 0)
+      || (index.descriptorType == DESCRIPTOR_PROFILE && index.nPoints != index.nDims)) {
+    throw "Invalid number of dimensions";
+  }
+  if (index.type == INDEX_TYPE_PQ && (index.nSubvectors <= 0 || index.nSubvectors > index.nDims)) {
+    throw "Invalid number of subvectors";
+  }
+  if (index.type == INDEX_TYPE_VPTREE && index.leafSize == 0) {
+    throw "Invalid size of the leaves";
+  }
+
+  // The sizes are compared by division, so that they do not overflow
+  size_t nDims = static_cast<size_t>(index.nDims);
+  size_t arraySize = alignProfileSize(sizeof(unsigned int) * index.nEntries);
+  size_t available = static_cast<size_t>(namesOffset - dataOffset);
+  bool isFit;
+  if (index.type == INDEX_TYPE_VPTREE) {
+    isFit = 3 * arraySize <= available
+      && (index.nEntries == 0 || nDims <= (available - 3 * arraySize) / sizeof(float) / index.nEntries);
+  } else {
+    size_t codebookSize = sizeof(float) * PQ_N_CENTROIDS;
+    isFit = nDims <= available / codebookSize
+      && (index.nEntries == 0 || static_cast<size_t>(index.nSubvectors) <= (available - codebookSize * nDims) / index.nEntries);
+  }
+  if (!isFit) {
+    throw "The data is out of the file";
+  }
+  const unsigned char *data = file.data + dataOffset;
+  index.ids       = reinterpret_cast<const unsigned int *>(data);
+  index.radii     = reinterpret_cast<const float *>(data + arraySize);
+  index.mids      = reinterpret_cast<const unsigned int *>(data + 2 * arraySize);
+  index.vectors   = reinterpret_cast<const float *>(data + 3 * arraySize);
+  index.codebooks = reinterpret_cast<const float *>(data);
+  index.codes     = data + sizeof(float) * PQ_N_CENTROIDS * nDims;
+  index.nameOffsets = reinterpret_cast<const unsigned long long *>(file.data + namesOffset);
+  if (index.type == INDEX_TYPE_VPTREE) {
+    validateVpTree(index);
+  }
+}
+
+
+/*!
+ * @brief Check the nodes of VP-tree
+ *
+ * Every index of the record must be less than the number of the records.
+ * The first position of the outside of each node must be the one which
+ * buildVpTree() gives, so that the children are in the node and the depth
+ * of the tree is logarithmic.
+ * @param [in] index  The index
+ */
+static void
+validateVpTree(const IndexView &index)
+{
+  REP (i, index.nEntries) {
+    if (index.ids[i] >= index.nEntries) {
+      throw "Index of the record is out of range";
+    }
+  }
+  std::vector<std::pair<size_t, size_t> > stack(1, std::make_pair(static_cast<size_t>(0), index.nEntries));
+  while (!stack.empty()) {
+    size_t lo = stack.back().first;
+    size_t hi = stack.back().second;
+    stack.pop_back();
+    if (hi - lo <= index.leafSize) {
+      continue;
+    }
+    size_t mid = lo + 1 + (hi - lo - 1) / 2;
+    if (index.mids[lo] != mid) {
+      throw "Invalid node of VP-tree";
+    }
+    stack.push_back(std::make_pair(lo + 1, mid));
+    stack.push_back(std::make_pair(mid, hi));
+  }
+}
+
+
+/*!
+ * @brief Search the nearest records in the node of VP-tree
+ *
+ * The side of the radius where the query is in is searched first, and the
+ * other side is searched only if the ball of the K-th distance around the
+ * query crosses the radius.
+ * @param [in]     index  The index
+ * @param [in]     query  Descriptor of the query
+ * @param [in]     lo     The first position of the node
+ * @param [in]     hi     The next position of the last of the node
+ * @param [in]     k      The number of the nearest records
+ * @param [in,out] heap   Max-heap of the K nearest records so far
+ */
+static void
+searchVpTree(const IndexView &index, const float *query, size_t lo, size_t hi, size_t k, std::vector<Neighbor> &heap)
+{
+  if (hi - lo <= index.leafSize) {
+    for (size_t i = lo; i < hi; i++) {
+      pushNeighbor(heap, k, Neighbor(calcL2Distance(query, index.vectors + i * static_cast<size_t>(index.nDims), index.nDims), index.ids[i]));
+    }
+    return;
+  }
+  float distance = calcL2Distance(query, index.vectors + lo * static_cast<size_t>(index.nDims), index.nDims);
+  pushNeighbor(heap, k, Neighbor(distance, index.ids[lo]));
+  size_t mid = index.mids[lo];
+  float radius = index.radii[lo];
+  if (distance < radius) {
+    searchVpTree(index, query, lo + 1, mid, k, heap);
+    if (distance + getHeapLimit(heap, k) >= radius) {
+      searchVpTree(index, query, mid, hi, k, heap);
+    }
+  } else {
+    searchVpTree(index, query, mid, hi, k, heap);
+    if (distance - getHeapLimit(heap, k) <= radius) {
+      searchVpTree(index, query, lo + 1, mid, k, heap);
+    }
+  }
+}
+
+
+/*!
+ * @brief Search the nearest records by the codes of product quantization
+ *
+ * The squared distances from each subvector of the query to the centroids
+ * are tabulated, and the approximate distance of each record is the sum of
+ * M entries of the table.
+ * @param [in]     index  The index
+ * @param [in]     query  Descriptor of the query
+ * @param [in]     k      The number of the nearest records
+ * @param [in,out] heap   Max-heap of the K nearest records
+ */
+static void
+searchProductQuantizer(const IndexView &index, const float *query, size_t k, std::vector<Neighbor> &heap)
+{
+  size_t nDims = static_cast<size_t>(index.nDims);
+  size_t m     = static_cast<size_t>(index.nSubvectors);
+  std::vector<float> table(m * PQ_N_CENTROIDS);
+  REP (j, m) {
+    size_t d0 = nDims * j / m;
+    size_t d1 = nDims * (j + 1) / m;
+    const float *centroids = index.codebooks + PQ_N_CENTROIDS * d0;
+    REP_I (c, PQ_N_CENTROIDS) {
+      table[j * PQ_N_CENTROIDS + static_cast<size_t>(c)] = sumSquaredDiff(query + d0, centroids + static_cast<size_t>(c) * (d1 - d0), static_cast<int>(d1 - d0));
+    }
+  }
+  // Compare the squared distances, and take the square roots of only the results
+  const float *entries = &table[0];
+  REP (i, index.nEntries) {
+    const unsigned char *code = index.codes + i * m;
+    // Four partial sums are accumulated independently to hide the latency of the additions
+    float sums[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    size_t j = 0;
+    for (; j + 4 <= m; j += 4) {
+      sums[0] += entries[j * PQ_N_CENTROIDS + code[j]];
+      sums[1] += entries[(j + 1) * PQ_N_CENTROIDS + code[j + 1]];
+      sums[2] += entries[(j + 2) * PQ_N_CENTROIDS + code[j + 2]];
+      sums[3] += entries[(j + 3) * PQ_N_CENTROIDS + code[j + 3]];
+    }
+    for (; j < m; j++) {
+      sums[0] += entries[j * PQ_N_CENTROIDS + code[j]];
+    }
+    float distance = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    if (distance < getHeapLimit(heap, k)) {
+      pushNeighbor(heap, k, Neighbor(distance, static_cast<unsigned int>(i)));
+    }
+  }
+  REP (i, heap.size()) {
+    heap[i].first = std::sqrt(heap[i].first);
+  }
+}
+
+
+/*!
+ * @brief Calculate Euclidean distance between two descriptors
+ * @param [in] a      A descriptor
+ * @param [in] b      The other descriptor
+ * @param [in] nDims  The number of dimensions
+ * @return  The distance
+ */
+ATTR_NOTHROW ALWAYSINLINE static float
+calcL2Distance(const float *a, const float *b, int nDims) noexcept
+{
+  return std::sqrt(sumSquaredDiff(a, b, nDims));
+}
+
+
+/*!
+ * @brief Get the name of the record in the index
+ *
+ * The name is empty if its offset is out of the index file.
+ * @param [in] index  The index
+ * @param [in] i      Index of the record
+ * @return  The name of the record
+ */
+static std::string
+getIndexName(const IndexView &index, size_t i)
+{
+  unsigned long long offset = index.nameOffsets[i];
+  if (offset > index.size - 4 || getLe32(index.data + offset) > index.size - offset - 4) {
+    return std::string();
+  }
+  const unsigned char *p = index.data + offset;
+  return std::string(reinterpret_cast<const char *>(p + 4), getLe32(p));
+}
+
+
+/*!
+ * @brief Check whether this machine is little-endian or not
+ * @return  true if this machine is little-endian, otherwise false
+ */
+ATTR_NOTHROW ALWAYSINLINE static bool
+isLittleEndian() noexcept
+{
+  unsigned int value = 1;
+  unsigned char bytes[sizeof(value)];
+  std::memcpy(bytes, &value, sizeof(value));
+  return bytes[0] == 1;
+}
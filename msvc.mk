@@ -8,7 +8,11 @@ TARGET_DIR1 = 01-concatImage
 TARGET_DIR2 = 02-edgeDetection
 TARGET_DIR3 = 03-fillArea
 TARGET_DIR4 = 04-evalArea
+TARGET_DIR5 = 05-profileToCsv
+TARGET_DIR6 = 06-shapeDistance
+TARGET_DIR7 = 07-shapeIndex
 DIR_LIST    = $(TARGET_DIR1) $(TARGET_DIR2) $(TARGET_DIR3) $(TARGET_DIR4)  \
+              $(TARGET_DIR5) $(TARGET_DIR6) $(TARGET_DIR7)
 
 
 all :
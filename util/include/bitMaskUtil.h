@@ -0,0 +1,181 @@
+/*!
+ * @brief Provide bit-packed masks of the region and the difference between
+ *        two masks
+ *
+ * Each row of the mask is packed into 64-bit words, whose bit i of word j is
+ * the pixel at x = 64 * j + i.  The difference between two masks of the same
+ * size is taken by XOR of the words, so that the unchanged parts of the rows
+ * are skipped by 64 pixels at a time, and only the changed pixels are
+ * extracted as runs.
+ *
+ * @author koturn 0;
+ * @file bitMaskUtil.h
+ */
+#ifndef BIT_MASK_UTIL_H
+#define BIT_MASK_UTIL_H
+
+#include <vector>
+#include "../../include/commonUtil/compat.h"
+#include "spanUtil.h"
+
+
+//! Bit-packed mask of the region
+struct BitMask {
+  int                             width;        //!< Width of the image
+  int                             height;       //!< Height of the image
+  size_t                          wordsPerRow;  //!< The number of 64-bit words of a row
+  std::vector<unsigned long long> words;        //!< Words of all rows
+
+  BitMask() :
+    width(0),
+    height(0),
+    wordsPerRow(0),
+    words()
+  {}
+};
+
+//! A run of the changed pixels in a row
+typedef struct {
+  int y;      //!< Y-position of the run
+  int begin;  //!< The first x-position of the run
+  int end;    //!< The next x-position of the last pixel of the run
+} MaskRun;
+
+
+ATTR_NOTHROW inline static void
+buildBitMask(BitMask &mask, const SpanIndex &index) noexcept;
+
+inline static void
+diffBitMask(const BitMask &prev, const BitMask &cur, std::vector<MaskRun> &added, std::vector<MaskRun> &removed);
+
+inline static void
+appendBitRuns(unsigned long long bits, int y, int x0, std::vector<MaskRun> &runs);
+
+ATTR_NOTHROW ALWAYSINLINE static int
+countTrailingZeros64(unsigned long long value) noexcept;
+
+
+
+
+/*!
+ * @brief Build the bit-packed mask of the region
+ *
+ * The words of each row are filled from the spans in parallel.
+ * @param [out] mask   Bit-packed mask of the region
+ * @param [in]  index  Run-length representation of the region
+ */
+ATTR_NOTHROW inline static void
+buildBitMask(BitMask &mask, const SpanIndex &index) noexcept
+{
+  mask.width  = index.width;
+  mask.height = index.height;
+  mask.wordsPerRow = (static_cast<size_t>(index.width) + 63) / 64;
+  mask.words.assign(mask.wordsPerRow * static_cast<size_t>(index.height), 0);
+
+  #pragma omp parallel for
+  for (int y = 0; y < index.height; y++) {
+    unsigned long long *row = mask.words.empty() ? nullptr : &mask.words[mask.wordsPerRow * static_cast<size_t>(y)];
+    for (int k = index.rowOffsets[static_cast<size_t>(y)]; k < index.rowOffsets[static_cast<size_t>(y) + 1]; k++) {
+      const Span &span = index.spans[static_cast<size_t>(k)];
+      int firstWord = span.begin >> 6;
+      int lastWord  = (span.end - 1) >> 6;
+      unsigned long long firstBits = ~0ULL << (span.begin & 63);
+      unsigned long long lastBits  = ~0ULL >> (63 - ((span.end - 1) & 63));
+      if (firstWord == lastWord) {
+        row[firstWord] |= firstBits & lastBits;
+        continue;
+      }
+      row[firstWord] |= firstBits;
+      for (int j = firstWord + 1; j < lastWord; j++) {
+        row[j] = ~0ULL;
+      }
+      row[lastWord] |= lastBits;
+    }
+  }
+}
+
+
+/*!
+ * @brief Extract the pixels which are added and removed from the previous
+ *        mask to the current mask
+ *
+ * The runs are sorted by row and x-position, and a run which crosses words
+ * is merged into one.  The masks must have the same size.
+ * @param [in]  prev     Bit-packed mask of the previous region
+ * @param [in]  cur      Bit-packed mask of the current region
+ * @param [out] added    Runs of the pixels which are only in the current region
+ * @param [out] removed  Runs of the pixels which are only in the previous region
+ */
+inline static void
+diffBitMask(const BitMask &prev, const BitMask &cur, std::vector<MaskRun> &added, std::vector<MaskRun> &removed)
+{
+  added.clear();
+  removed.clear();
+  for (int y = 0; y < cur.height; y++) {
+    size_t base = cur.wordsPerRow * static_cast<size_t>(y);
+    for (size_t j = 0; j < cur.wordsPerRow; j++) {
+      unsigned long long changed = prev.words[base + j] ^ cur.words[base + j];
+      if (changed == 0) {
+        continue;
+      }
+      appendBitRuns(changed & cur.words[base + j], y, static_cast<int>(j) * 64, added);
+      appendBitRuns(changed & prev.words[base + j], y, static_cast<int>(j) * 64, removed);
+    }
+  }
+}
+
+
+/*!
+ * @brief Append the runs of the set bits of the word
+ *
+ * If the first run continues the last run in the same row, the last run is
+ * extended.
+ * @param [in]     bits  A word of the mask
+ * @param [in]     y     Y-position of the word
+ * @param [in]     x0    X-position of the least significant bit of the word
+ * @param [in,out] runs  Runs of the set bits
+ */
+inline static void
+appendBitRuns(unsigned long long bits, int y, int x0, std::vector<MaskRun> &runs)
+{
+  int offset = 0;
+  while (bits != 0) {
+    int nZeros = countTrailingZeros64(bits);
+    bits >>= nZeros;
+    offset += nZeros;
+    int nOnes = ~bits == 0 ? 64 - offset : countTrailingZeros64(~bits);
+    MaskRun run = {y, x0 + offset, x0 + offset + nOnes};
+    if (!runs.empty() && runs.back().y == y && runs.back().end == run.begin) {
+      runs.back().end = run.end;
+    } else {
+      runs.push_back(run);
+    }
+    bits = nOnes == 64 ? 0 : bits >> nOnes;
+    offset += nOnes;
+  }
+}
+
+
+/*!
+ * @brief Count the trailing zero bits of the non-zero value
+ * @param [in] value  A non-zero value
+ * @return  The number of the trailing zero bits
+ */
+ATTR_NOTHROW ALWAYSINLINE static int
+countTrailingZeros64(unsigned long long value) noexcept
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(value);
+#else
+  int n = 0;
+  for (; (value & 1) == 0; value >>= 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+
+
+
+#endif  // BIT_MASK_UTIL_H
@@ -0,0 +1,321 @@
+/*!
+ * @brief Provide utility functions of the on-disk cache of results, which is
+ *        keyed by a 64-bit hash of the input and the parameters
+ *
+ * A cache is a directory which has a data file for each entry and an index
+ * file.  The data file is named after the key in hexadecimal ("KEY.bin"),
+ * and has the key followed by the cached data.  The index file ("index.bin")
+ * is read by mapping it into memory when the cache is opened, and rewritten
+ * when the cache is closed.
+ *
+ *   Index header (24 bytes)
+ *     char[8]   magic "EVCACHE\0"
+ *     uint32    version
+ *     uint32    reserved (0)
+ *     uint64    clock, which is incremented on each use of an entry
+ *   Index entry (24 bytes)
+ *     uint64    key
+ *     uint64    clock when the entry was used last
+ *     uint64    size of the data file in bytes
+ *
+ * When the total size of the data files exceeds the maximum size, the least
+ * recently used entries are evicted.
+ *
+ * @author koturn 0;
+ * @file cacheUtil.h
+ */
+#ifndef CACHE_UTIL_H
+#define CACHE_UTIL_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../include/commonUtil/compat.h"
+#include "fileUtil.h"
+#include "mmapUtil.h"
+#include "profileUtil.h"
+
+
+static const char     CACHE_MAGIC[8]          = {'E', 'V', 'C', 'A', 'C', 'H', 'E', '\0'};  //!< Magic of the index file
+static const unsigned CACHE_VERSION           = 1;   //!< Version of the format
+static const size_t   CACHE_INDEX_HEADER_SIZE = 24;  //!< Size of the index header
+static const size_t   CACHE_INDEX_ENTRY_SIZE  = 24;  //!< Size of an index entry
+
+//! An entry of the cache
+typedef struct {
+  unsigned long long lastUsed;  //!< Clock when the entry was used last
+  unsigned long long size;      //!< Size of the data file in bytes
+} CacheEntry;
+
+//! The on-disk cache of results
+struct ResultCache {
+  std::string                              dirname;     //!< A name of the cache directory
+  unsigned long long                       maxSize;     //!< Maximum total size of the data files in bytes
+  unsigned long long                       totalSize;   //!< Total size of the data files in bytes
+  unsigned long long                       clock;       //!< Clock which is incremented on each use of an entry
+  std::map<unsigned long long, CacheEntry> entries;     //!< Entries of the cache keyed by the hash
+  unsigned long long                       nHits;       //!< The number of the lookups which are found
+  unsigned long long                       nMisses;     //!< The number of the lookups which are not found
+  unsigned long long                       nEvictions;  //!< The number of the evicted entries
+
+  ResultCache() :
+    dirname(),
+    maxSize(0),
+    totalSize(0),
+    clock(0),
+    entries(),
+    nHits(0),
+    nMisses(0),
+    nEvictions(0)
+  {}
+};
+
+
+inline static bool
+openResultCache(ResultCache &cache, const char *dirname, unsigned long long maxSize);
+
+inline static bool
+lookupResultCache(ResultCache &cache, unsigned long long key, std::vector<unsigned char> &data);
+
+inline static bool
+storeResultCache(ResultCache &cache, unsigned long long key, const std::vector<unsigned char> &data);
+
+inline static bool
+closeResultCache(ResultCache &cache);
+
+inline static void
+evictResultCache(ResultCache &cache);
+
+inline static std::string
+getCacheDataFilename(const ResultCache &cache, unsigned long long key);
+
+inline static std::string
+getCacheIndexFilename(const ResultCache &cache);
+
+
+
+
+/*!
+ * @brief Open the cache directory and read its index
+ *
+ * The directory is made if it doesn't exist.  If the index file is broken,
+ * the cache is treated as empty.
+ * @param [out] cache    The cache
+ * @param [in]  dirname  A name of the cache directory
+ * @param [in]  maxSize  Maximum total size of the data files in bytes
+ * @return  true if succeeded, otherwise false
+ */
+inline static bool
+openResultCache(ResultCache &cache, const char *dirname, unsigned long long maxSize)
+{
+  cache = ResultCache();
+  cache.dirname = dirname;
+  cache.maxSize = maxSize;
+  if (!makeDirectory(dirname)) {
+    return false;
+  }
+
+  MappedFile indexFile;
+  if (!openMappedFile(indexFile, getCacheIndexFilename(cache).c_str())) {
+    return true;
+  }
+  if (indexFile.size >= CACHE_INDEX_HEADER_SIZE && std::memcmp(indexFile.data, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+      && getLe32(indexFile.data + 8) == CACHE_VERSION) {
+    cache.clock = getLe64(indexFile.data + 16);
+    for (size_t pos = CACHE_INDEX_HEADER_SIZE; pos + CACHE_INDEX_ENTRY_SIZE <= indexFile.size; pos += CACHE_INDEX_ENTRY_SIZE) {
+      CacheEntry entry;
+      entry.lastUsed = getLe64(indexFile.data + pos + 8);
+      entry.size     = getLe64(indexFile.data + pos + 16);
+      cache.entries[getLe64(indexFile.data + pos)] = entry;
+      cache.totalSize += entry.size;
+    }
+  }
+  closeMappedFile(indexFile);
+  return true;
+}
+
+
+/*!
+ * @brief Look up the entry and read its data
+ *
+ * The entry is marked as the most recently used one.  If its data file is
+ * lost or broken, the entry is removed and a miss is counted.
+ * This function is not thread-safe.
+ * @param [in,out] cache  The cache
+ * @param [in]     key    Key of the entry
+ * @param [out]    data   The cached data
+ * @return  true if the entry is found, otherwise false
+ */
+inline static bool
+lookupResultCache(ResultCache &cache, unsigned long long key, std::vector<unsigned char> &data)
+{
+  std::map<unsigned long long, CacheEntry>::iterator itr = cache.entries.find(key);
+  if (itr == cache.entries.end()) {
+    cache.nMisses++;
+    return false;
+  }
+  MappedFile dataFile;
+  bool isValid = openMappedFile(dataFile, getCacheDataFilename(cache, key).c_str());
+  if (isValid) {
+    isValid = dataFile.size >= 8 && dataFile.size == itr->second.size && getLe64(dataFile.data) == key;
+    if (isValid) {
+      data.assign(dataFile.data + 8, dataFile.data + dataFile.size);
+    }
+    closeMappedFile(dataFile);
+  }
+  if (!isValid) {
+    cache.totalSize -= itr->second.size;
+    cache.entries.erase(itr);
+    cache.nMisses++;
+    return false;
+  }
+  itr->second.lastUsed = ++cache.clock;
+  cache.nHits++;
+  return true;
+}
+
+
+/*!
+ * @brief Write the data of the entry and evict the least recently used
+ *        entries if the total size exceeds the maximum size
+ *
+ * This function is not thread-safe.
+ * @param [in,out] cache  The cache
+ * @param [in]     key    Key of the entry
+ * @param [in]     data   The data to cache
+ * @return  true if succeeded, otherwise false
+ */
+inline static bool
+storeResultCache(ResultCache &cache, unsigned long long key, const std::vector<unsigned char> &data)
+{
+  std::string filename = getCacheDataFilename(cache, key);
+  std::FILE *fp = std::fopen(filename.c_str(), "wb");
+  if (fp == nullptr) {
+    return false;
+  }
+  unsigned char header[8];
+  putLe64(header, key);
+  bool isSucceeded = std::fwrite(header, 1, sizeof(header), fp) == sizeof(header)
+    && (data.empty() || std::fwrite(&data[0], 1, data.size(), fp) == data.size());
+  std::fclose(fp);
+  if (!isSucceeded) {
+    std::remove(filename.c_str());
+    return false;
+  }
+
+  std::map<unsigned long long, CacheEntry>::iterator itr = cache.entries.find(key);
+  if (itr != cache.entries.end()) {
+    cache.totalSize -= itr->second.size;
+  }
+  CacheEntry &entry = cache.entries[key];
+  entry.lastUsed = ++cache.clock;
+  entry.size     = sizeof(header) + data.size();
+  cache.totalSize += entry.size;
+  evictResultCache(cache);
+  return true;
+}
+
+
+/*!
+ * @brief Write the index of the cache
+ *
+ * The index is written into a temporary file first, and renamed, so that
+ * the index is not broken even if the program is terminated while writing.
+ * @param [in,out] cache  The cache
+ * @return  true if succeeded, otherwise false
+ */
+inline static bool
+closeResultCache(ResultCache &cache)
+{
+  evictResultCache(cache);
+  std::string indexFilename = getCacheIndexFilename(cache);
+  std::string tmpFilename = indexFilename + ".tmp";
+  std::FILE *fp = std::fopen(tmpFilename.c_str(), "wb");
+  if (fp == nullptr) {
+    return false;
+  }
+  std::vector<unsigned char> buffer(CACHE_INDEX_HEADER_SIZE + CACHE_INDEX_ENTRY_SIZE * cache.entries.size(), 0);
+  unsigned char *p = &buffer[0];
+  std::memcpy(p, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  putLe32(p + 8, CACHE_VERSION);
+  putLe64(p + 16, cache.clock);
+  p += CACHE_INDEX_HEADER_SIZE;
+  for (std::map<unsigned long long, CacheEntry>::const_iterator itr = cache.entries.begin(); itr != cache.entries.end(); ++itr) {
+    putLe64(p, itr->first);
+    putLe64(p + 8, itr->second.lastUsed);
+    putLe64(p + 16, itr->second.size);
+    p += CACHE_INDEX_ENTRY_SIZE;
+  }
+  bool isSucceeded = std::fwrite(&buffer[0], 1, buffer.size(), fp) == buffer.size();
+  isSucceeded = std::fclose(fp) == 0 && isSucceeded;
+#ifdef _WIN32
+  std::remove(indexFilename.c_str());
+#endif
+  if (!isSucceeded || std::rename(tmpFilename.c_str(), indexFilename.c_str()) != 0) {
+    std::remove(tmpFilename.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Remove the least recently used entries and their data files until
+ *        the total size is within the maximum size
+ * @param [in,out] cache  The cache
+ */
+inline static void
+evictResultCache(ResultCache &cache)
+{
+  if (cache.totalSize <= cache.maxSize) {
+    return;
+  }
+  std::vector<std::pair<unsigned long long, unsigned long long> > order;
+  for (std::map<unsigned long long, CacheEntry>::const_iterator itr = cache.entries.begin(); itr != cache.entries.end(); ++itr) {
+    order.push_back(std::make_pair(itr->second.lastUsed, itr->first));
+  }
+  std::sort(order.begin(), order.end());
+  for (size_t i = 0; i < order.size() && cache.totalSize > cache.maxSize; i++) {
+    std::map<unsigned long long, CacheEntry>::iterator itr = cache.entries.find(order[i].second);
+    std::remove(getCacheDataFilename(cache, itr->first).c_str());
+    cache.totalSize -= itr->second.size;
+    cache.entries.erase(itr);
+    cache.nEvictions++;
+  }
+}
+
+
+/*!
+ * @brief Get the name of the data file of the entry
+ * @param [in] cache  The cache
+ * @param [in] key    Key of the entry
+ * @return  A name of the data file
+ */
+inline static std::string
+getCacheDataFilename(const ResultCache &cache, unsigned long long key)
+{
+  char buf[32];
+  std::sprintf(buf, "/%016llx.bin", key);
+  return cache.dirname + buf;
+}
+
+
+/*!
+ * @brief Get the name of the index file of the cache
+ * @param [in] cache  The cache
+ * @return  A name of the index file
+ */
+inline static std::string
+getCacheIndexFilename(const ResultCache &cache)
+{
+  return cache.dirname + "/index.bin";
+}
+
+
+
+
+#endif  // CACHE_UTIL_H
@@ -0,0 +1,227 @@
+/*!
+ * @brief Provide utility functions for classifying colors of pixels
+ *
+ * A foreground color is matched either exactly or with tolerance.
+ * In the latter case, the RGB color space is quantized into 32x32x32 cells
+ * and a bitset of cells which are regarded as foreground is built once,
+ * so that the classification of each pixel is one table lookup.
+ *
+ * @author koturn 0;
+ * @file colorUtil.h
+ */
+#ifndef COLOR_UTIL_H
+#define COLOR_UTIL_H
+
+#include <cmath>
+#include <cstring>
+#include "../../include/commonUtil/compat.h"
+
+
+//! Metric of the distance between two colors
+typedef enum {
+  COLOR_METRIC_LINF,    //!< Chebyshev distance in RGB space
+  COLOR_METRIC_DELTA_E  //!< CIE76 color difference in L*a*b* space
+} ColorMetric;
+
+static const int R_MASK = 0x00ff0000;  //!< Mask for taking out the red from int value
+static const int G_MASK = 0x0000ff00;  //!< Mask for taking out the green from int value
+static const int B_MASK = 0x000000ff;  //!< Mask for taking out the blue from int value
+
+static const int COLOR_LUT_BITS  = 5;                             //!< Bits per channel used for the index of the LUT
+static const int COLOR_LUT_LEVEL = 1 << COLOR_LUT_BITS;           //!< The number of cells per channel
+static const int COLOR_LUT_SHIFT = 8 - COLOR_LUT_BITS;            //!< Shift width from 8-bit channel to the index of the LUT
+static const int COLOR_LUT_SIZE  = 1 << (3 * COLOR_LUT_BITS);     //!< The number of cells
+static const int COLOR_LUT_WORDS = COLOR_LUT_SIZE / 32;           //!< The number of words of the bitset
+
+//! Classifier of the foreground color
+typedef struct {
+  int          color;                  //!< Foreground color (0xRRGGBB)
+  bool         isExact;                //!< Compare with the foreground color exactly or not
+  unsigned int lut[COLOR_LUT_WORDS];   //!< Bitset of cells which are regarded as foreground
+} ColorMatcher;
+
+
+ATTR_NOTHROW inline static void
+initColorMatcher(ColorMatcher &matcher, int color, double tolerance, ColorMetric metric) noexcept;
+
+inline static ColorMetric
+parseColorMetric(const char *metricString);
+
+ATTR_NOTHROW ALWAYSINLINE static int
+pixelToRgb(const unsigned char *pixel) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static bool
+isForegroundPixel(const ColorMatcher &matcher, const unsigned char *pixel) noexcept;
+
+ATTR_NOTHROW inline static void
+rgbToLab(double r, double g, double b, double lab[3]) noexcept;
+
+ATTR_NOTHROW inline static double
+calcColorDistance(const double rgb1[3], const double rgb2[3], ColorMetric metric) noexcept;
+
+
+
+
+/*!
+ * @brief Initialize the classifier of the foreground color
+ *
+ * If tolerance is zero, the pixels are compared with the foreground color
+ * exactly.  Otherwise, the cell of the LUT is regarded as foreground if the
+ * nearest color in the cell to the foreground color is within tolerance.
+ * @param [out] matcher    Classifier of the foreground color
+ * @param [in]  color      Foreground color (0xRRGGBB)
+ * @param [in]  tolerance  Maximum distance from the foreground color
+ * @param [in]  metric     Metric of the distance
+ */
+ATTR_NOTHROW inline static void
+initColorMatcher(ColorMatcher &matcher, int color, double tolerance, ColorMetric metric) noexcept
+{
+  static const int CELL_WIDTH = 1 << COLOR_LUT_SHIFT;
+
+  matcher.color   = color & 0x00ffffff;
+  matcher.isExact = tolerance <= 0.0;
+  std::memset(matcher.lut, 0, sizeof(matcher.lut));
+  if (matcher.isExact) {
+    return;
+  }
+
+  double fg[3] = {
+    static_cast<double>((color & 0x00ff0000) >> 16),
+    static_cast<double>((color & 0x0000ff00) >> 8),
+    static_cast<double>((color & 0x000000ff))
+  };
+  for (int r = 0; r < COLOR_LUT_LEVEL; r++) {
+    for (int g = 0; g < COLOR_LUT_LEVEL; g++) {
+      for (int b = 0; b < COLOR_LUT_LEVEL; b++) {
+        int lo[3] = {r * CELL_WIDTH, g * CELL_WIDTH, b * CELL_WIDTH};
+        double nearest[3];
+        double center[3];
+        for (int i = 0; i < 3; i++) {
+          double hi  = lo[i] + CELL_WIDTH - 1;
+          nearest[i] = fg[i] < lo[i] ? lo[i] : fg[i] > hi ? hi : fg[i];
+          center[i]  = lo[i] + (CELL_WIDTH - 1) / 2.0;
+        }
+        // In L*a*b* space, the color which is nearest in RGB space is not
+        // always the nearest one, so that the center of the cell is also checked.
+        if (calcColorDistance(fg, nearest, metric) <= tolerance
+            || calcColorDistance(fg, center, metric) <= tolerance) {
+          int idx = (r << (2 * COLOR_LUT_BITS)) | (g << COLOR_LUT_BITS) | b;
+          matcher.lut[idx >> 5] |= 1U << (idx & 31);
+        }
+      }
+    }
+  }
+}
+
+
+/*!
+ * @brief Parse a string which specifies the metric of the color distance
+ * @param [in] metricString  "linf" or "deltae"
+ * @return  Metric of the color distance
+ */
+inline static ColorMetric
+parseColorMetric(const char *metricString)
+{
+  if (!std::strcmp(metricString, "linf")) {
+    return COLOR_METRIC_LINF;
+  } else if (!std::strcmp(metricString, "deltae")) {
+    return COLOR_METRIC_DELTA_E;
+  } else {
+    throw "Invalid metric of color distance is specified";
+  }
+}
+
+
+/*!
+ * @brief Convert the BGR pixel to int value (0xRRGGBB)
+ * @param [in] pixel  Address of the pixel
+ * @return  RGB value of the pixel
+ */
+ATTR_NOTHROW ALWAYSINLINE static int
+pixelToRgb(const unsigned char *pixel) noexcept
+{
+  return (pixel[2] << 16) | (pixel[1] << 8) | pixel[0];
+}
+
+
+/*!
+ * @brief Check whether the BGR pixel is the foreground or not
+ * @param [in] matcher  Classifier of the foreground color
+ * @param [in] pixel    Address of the pixel
+ * @return  true if the pixel is the foreground, otherwise false
+ */
+ATTR_NOTHROW ALWAYSINLINE static bool
+isForegroundPixel(const ColorMatcher &matcher, const unsigned char *pixel) noexcept
+{
+  if (matcher.isExact) {
+    return pixelToRgb(pixel) == matcher.color;
+  }
+  int idx = ((pixel[2] >> COLOR_LUT_SHIFT) << (2 * COLOR_LUT_BITS))
+    | ((pixel[1] >> COLOR_LUT_SHIFT) << COLOR_LUT_BITS)
+    | (pixel[0] >> COLOR_LUT_SHIFT);
+  return (matcher.lut[idx >> 5] >> (idx & 31)) & 1U;
+}
+
+
+/*!
+ * @brief Convert sRGB color to CIE L*a*b* color (D65)
+ * @param [in]  r    Red value [0, 255]
+ * @param [in]  g    Green value [0, 255]
+ * @param [in]  b    Blue value [0, 255]
+ * @param [out] lab  L*, a* and b* value
+ */
+ATTR_NOTHROW inline static void
+rgbToLab(double r, double g, double b, double lab[3]) noexcept
+{
+  static const double XN = 0.950456;
+  static const double ZN = 1.088754;
+
+  double rgb[3] = {r / 255.0, g / 255.0, b / 255.0};
+  for (int i = 0; i < 3; i++) {
+    rgb[i] = rgb[i] <= 0.04045 ? rgb[i] / 12.92 : std::pow((rgb[i] + 0.055) / 1.055, 2.4);
+  }
+  double xyz[3] = {
+    (0.412453 * rgb[0] + 0.357580 * rgb[1] + 0.180423 * rgb[2]) / XN,
+    (0.212671 * rgb[0] + 0.715160 * rgb[1] + 0.072169 * rgb[2]),
+    (0.019334 * rgb[0] + 0.119193 * rgb[1] + 0.950227 * rgb[2]) / ZN
+  };
+  for (int i = 0; i < 3; i++) {
+    xyz[i] = xyz[i] > 0.008856 ? std::pow(xyz[i], 1.0 / 3.0) : 7.787 * xyz[i] + 16.0 / 116.0;
+  }
+  lab[0] = 116.0 * xyz[1] - 16.0;
+  lab[1] = 500.0 * (xyz[0] - xyz[1]);
+  lab[2] = 200.0 * (xyz[1] - xyz[2]);
+}
+
+
+/*!
+ * @brief Calculate the distance between two colors
+ * @param [in] rgb1    First color (R, G, B)
+ * @param [in] rgb2    Second color (R, G, B)
+ * @param [in] metric  Metric of the distance
+ * @return  The distance between two colors
+ */
+ATTR_NOTHROW inline static double
+calcColorDistance(const double rgb1[3], const double rgb2[3], ColorMetric metric) noexcept
+{
+  if (metric == COLOR_METRIC_LINF) {
+    double d = 0.0;
+    for (int i = 0; i < 3; i++) {
+      double diff = std::fabs(rgb1[i] - rgb2[i]);
+      if (d < diff) d = diff;
+    }
+    return d;
+  } else {
+    double lab1[3], lab2[3];
+    rgbToLab(rgb1[0], rgb1[1], rgb1[2], lab1);
+    rgbToLab(rgb2[0], rgb2[1], rgb2[2], lab2);
+    return std::sqrt((lab1[0] - lab2[0]) * (lab1[0] - lab2[0])
+        + (lab1[1] - lab2[1]) * (lab1[1] - lab2[1])
+        + (lab1[2] - lab2[2]) * (lab1[2] - lab2[2]));
+  }
+}
+
+
+
+
+#endif  // COLOR_UTIL_H
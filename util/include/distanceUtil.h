@@ -0,0 +1,59 @@
+/*!
+ * @brief Provide utility functions to calculate the distances between float
+ *        vectors
+ *
+ * Four elements are calculated at a time with SSE2 if it is available, and
+ * the rest of the elements are calculated one by one.
+ *
+ * @author koturn 0;
+ * @file distanceUtil.h
+ */
+#ifndef DISTANCE_UTIL_H
+#define DISTANCE_UTIL_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define DISTANCE_UTIL_USE_SSE2
+#endif
+#include "../../include/commonUtil/compat.h"
+
+
+ATTR_NOTHROW ALWAYSINLINE static float
+sumSquaredDiff(const float *a, const float *b, int n) noexcept;
+
+
+
+
+/*!
+ * @brief Calculate the sum of the squared differences of two arrays
+ * @param [in] a  An array
+ * @param [in] b  The other array
+ * @param [in] n  The number of elements
+ * @return  The sum of the squared differences
+ */
+ATTR_NOTHROW ALWAYSINLINE static float
+sumSquaredDiff(const float *a, const float *b, int n) noexcept
+{
+  int i = 0;
+  float sum = 0.0f;
+#ifdef DISTANCE_UTIL_USE_SSE2
+  __m128 sums = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    __m128 diff = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    sums = _mm_add_ps(sums, _mm_mul_ps(diff, diff));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, sums);
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+  for (; i < n; i++) {
+    float diff = a[i] - b[i];
+    sum += diff * diff;
+  }
+  return sum;
+}
+
+
+
+
+#endif  // DISTANCE_UTIL_H
@@ -0,0 +1,213 @@
+/*!
+ * @brief Provide utility functions of files and directories
+ * @author koturn 0;
+ * @file fileUtil.h
+ */
+#ifndef FILE_UTIL_H
+#define FILE_UTIL_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <dirent.h>
+#  include <sys/stat.h>
+#endif
+#include "../../include/commonUtil/compat.h"
+
+
+ATTR_NOTHROW inline static bool
+isDirectory(const char *path) noexcept;
+
+ATTR_NOTHROW inline static long long
+getFileSize(const char *filename) noexcept;
+
+ATTR_NOTHROW inline static bool
+makeDirectory(const char *path) noexcept;
+
+inline static bool
+listDirectory(const char *dirname, std::vector<std::string> &filenames);
+
+inline static bool
+readManifest(const char *filename, std::vector<std::string> &filenames);
+
+ATTR_NOTHROW inline static bool
+isImageFilename(const std::string &filename) noexcept;
+
+
+
+
+/*!
+ * @brief Check whether the path is a directory or not
+ * @param [in] path  A path
+ * @return  true if the path is a directory, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+isDirectory(const char *path) noexcept
+{
+#ifdef _WIN32
+  DWORD attributes = GetFileAttributesA(path);
+  return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+
+/*!
+ * @brief Get the size of the file
+ * @param [in] filename  A name of the file
+ * @return  Size of the file in bytes, or -1 if failed
+ */
+ATTR_NOTHROW inline static long long
+getFileSize(const char *filename) noexcept
+{
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &data)) {
+    return -1;
+  }
+  return (static_cast<long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+#else
+  struct stat st;
+  return stat(filename, &st) == 0 ? static_cast<long long>(st.st_size) : -1;
+#endif
+}
+
+
+/*!
+ * @brief Make the directory if it doesn't exist (not recursive)
+ * @param [in] path  A path of the directory
+ * @return  true if the directory exists or is made, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+makeDirectory(const char *path) noexcept
+{
+  if (isDirectory(path)) {
+    return true;
+  }
+#ifdef _WIN32
+  return CreateDirectoryA(path, nullptr) != 0;
+#else
+  return mkdir(path, 0755) == 0;
+#endif
+}
+
+
+/*!
+ * @brief List the files in the directory (not recursive)
+ * @param [in]  dirname    A name of the directory
+ * @param [out] filenames  Paths of the files, which are sorted
+ * @return  true if succeeded, otherwise false
+ */
+inline static bool
+listDirectory(const char *dirname, std::vector<std::string> &filenames)
+{
+  std::string prefix(dirname);
+  if (!prefix.empty() && prefix[prefix.size() - 1] != '/' && prefix[prefix.size() - 1] != '\\') {
+    prefix += '/';
+  }
+  filenames.clear();
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE hFind = FindFirstFileA((prefix + "*").c_str(), &data);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  do {
+    if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+      filenames.push_back(prefix + data.cFileName);
+    }
+  } while (FindNextFileA(hFind, &data));
+  FindClose(hFind);
+#else
+  DIR *dir = opendir(dirname);
+  if (dir == nullptr) {
+    return false;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    std::string path = prefix + entry->d_name;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      filenames.push_back(path);
+    }
+  }
+  closedir(dir);
+#endif
+  std::sort(filenames.begin(), filenames.end());
+  return true;
+}
+
+
+/*!
+ * @brief Read the file names from the manifest file
+ *
+ * The manifest file has one file name per line.  Empty lines and lines which
+ * begin with '#' are ignored.
+ * @param [in]  filename   A name of the manifest file
+ * @param [out] filenames  File names in the manifest file
+ * @return  true if succeeded, otherwise false
+ */
+inline static bool
+readManifest(const char *filename, std::vector<std::string> &filenames)
+{
+  std::ifstream ifs(filename);
+  if (!ifs.is_open()) {
+    return false;
+  }
+  filenames.clear();
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+      line.erase(line.size() - 1);
+    }
+    if (line.empty() || line[0] == '#') continue;
+    filenames.push_back(line);
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Check whether the file name has a suffix of image which OpenCV can
+ *        read or not
+ * @param [in] filename  A file name
+ * @return  true if the file name has a suffix of image, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+isImageFilename(const std::string &filename) noexcept
+{
+  static const char *SUFFIXES[] = {
+    "bmp", "dib", "jpeg", "jpg", "jpe", "jp2", "png", "pbm", "pgm", "ppm",
+    "sr", "ras", "tiff", "tif"
+  };
+  std::string::size_type idx = filename.find_last_of('.');
+  if (idx == std::string::npos) {
+    return false;
+  }
+  std::string suffix = filename.substr(idx + 1);
+  for (size_t i = 0; i < suffix.size(); i++) {
+    suffix[i] = static_cast<char>(std::tolower(suffix[i]));
+  }
+  for (size_t i = 0; i < sizeof(SUFFIXES) / sizeof(SUFFIXES[0]); i++) {
+    if (suffix == SUFFIXES[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+
+#endif  // FILE_UTIL_H
@@ -0,0 +1,239 @@
+/*!
+ * @brief Provide utility functions to fill the area surrounded by the line
+ *        of the foreground color
+ *
+ * The image is filled in place, row by row (x-axis base) or column by column
+ * (y-axis base), between the first and the last pixel of the foreground
+ * color.
+ *
+ * @author koturn 0;
+ * @file fillUtil.h
+ */
+#ifndef FILL_UTIL_H
+#define FILL_UTIL_H
+
+#include <vector>
+#include <opencv/cv.h>
+#include "../../include/commonUtil/compat.h"
+#include "colorUtil.h"
+
+
+ATTR_NOTHROW inline static void
+fillAreaXBase(cv::Mat &image, const ColorMatcher &matcher, std::vector<cv::Mat> *savedRows) noexcept;
+
+ATTR_NOTHROW inline static void
+fillAreaYBase(cv::Mat &image, const ColorMatcher &matcher, std::vector<cv::Mat> *savedRows) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static void
+saveRow(const cv::Mat &image, int y, std::vector<cv::Mat> *savedRows) noexcept;
+
+ATTR_NOTHROW inline static void
+restoreRows(cv::Mat &image, const std::vector<cv::Mat> &savedRows) noexcept;
+
+ATTR_NOTHROW inline static cv::Rect
+searchArea(const cv::Mat &image, const ColorMatcher &matcher) noexcept;
+
+ATTR_NOTHROW inline static cv::Rect
+addBlankToRect(const cv::Size &imageSize, const cv::Rect &roiRect, int blank) noexcept;
+
+ATTR_NOTHROW inline static void
+fillColumnRanges(cv::Mat &band, const ColorMatcher &matcher, int y0, const std::vector<int> &firstRows, const std::vector<int> &lastRows) noexcept;
+
+
+
+
+/*!
+ * @brief Fill area surrounded by specified color line with x-axis base
+ *
+ * The image is filled in place.
+ * @param [in,out] image      A image you want to fill
+ * @param [in]     matcher    Classifier of the color of line and area
+ * @param [out]    savedRows  Original rows which are overwritten.
+ *                            If nullptr is given, no row is saved.
+ */
+ATTR_NOTHROW inline static void
+fillAreaXBase(cv::Mat &image, const ColorMatcher &matcher, std::vector<cv::Mat> *savedRows) noexcept
+{
+  int foregroundColor = matcher.color;
+  unsigned char foregroundR = static_cast<unsigned char>((foregroundColor & R_MASK) >> 16);
+  unsigned char foregroundG = static_cast<unsigned char>((foregroundColor & G_MASK) >> 8);
+  unsigned char foregroundB = static_cast<unsigned char>((foregroundColor & B_MASK));
+
+  for (int y = 0; y < image.rows; y++) {
+    int x1 = 0;
+    while (x1 < image.cols) {
+      for (; x1 < image.cols && !isForegroundPixel(matcher, &image.data[y * image.step + x1 * image.elemSize()]); x1++);
+      for (; x1 < image.cols && isForegroundPixel(matcher, &image.data[y * image.step + x1 * image.elemSize()]); x1++);
+
+      int x2 = x1;
+      for (; x2 < image.cols && !isForegroundPixel(matcher, &image.data[y * image.step + x2 * image.elemSize()]); x2++);
+
+      if (x2 == image.cols) continue;
+
+      saveRow(image, y, savedRows);
+      for (int px = x1; px < x2; px++) {
+        unsigned char *restrict pixelAddr = &image.data[y * image.step + px * image.elemSize()];
+        pixelAddr[0] = foregroundB;
+        pixelAddr[1] = foregroundG;
+        pixelAddr[2] = foregroundR;
+      }
+    }
+  }
+}
+
+
+/*!
+ * @brief Fill area surrounded by specified color line with y-axis base
+ *
+ * The image is filled in place.
+ * @param [in,out] image      A image you want to fill
+ * @param [in]     matcher    Classifier of the color of line and area
+ * @param [out]    savedRows  Original rows which are overwritten.
+ *                            If nullptr is given, no row is saved.
+ */
+ATTR_NOTHROW inline static void
+fillAreaYBase(cv::Mat &image, const ColorMatcher &matcher, std::vector<cv::Mat> *savedRows) noexcept
+{
+  int foregroundColor = matcher.color;
+  unsigned char foregroundR = static_cast<unsigned char>((foregroundColor & R_MASK) >> 16);
+  unsigned char foregroundG = static_cast<unsigned char>((foregroundColor & G_MASK) >> 8);
+  unsigned char foregroundB = static_cast<unsigned char>((foregroundColor & B_MASK));
+
+  for (int x = 0; x < image.cols; x++) {
+    int y1 = 0;
+    while (y1 < image.rows) {
+      for (; y1 < image.rows && !isForegroundPixel(matcher, &image.data[y1 * image.step + x * image.elemSize()]); y1++);
+      for (; y1 < image.rows && isForegroundPixel(matcher, &image.data[y1 * image.step + x * image.elemSize()]); y1++);
+
+      int y2 = y1;
+      for (; y2 < image.rows && !isForegroundPixel(matcher, &image.data[y2 * image.step + x * image.elemSize()]); y2++);
+
+      if (y2 == image.rows) continue;
+
+      for (int py = y1; py < y2; py++) {
+        saveRow(image, py, savedRows);
+        unsigned char *restrict pixelAddr = &image.data[py * image.step + x * image.elemSize()];
+        pixelAddr[0] = foregroundB;
+        pixelAddr[1] = foregroundG;
+        pixelAddr[2] = foregroundR;
+      }
+    }
+  }
+}
+
+
+/*!
+ * @brief Save the original contents of the row before it is overwritten
+ *
+ * Each row is copied only once, at the first time it is overwritten.
+ * @param [in]  image      A image which is being filled
+ * @param [in]  y          Index of the row
+ * @param [out] savedRows  Original rows.  If nullptr is given, do nothing.
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+saveRow(const cv::Mat &image, int y, std::vector<cv::Mat> *savedRows) noexcept
+{
+  if (savedRows != nullptr && (*savedRows)[static_cast<std::vector<cv::Mat>::size_type>(y)].empty()) {
+    (*savedRows)[static_cast<std::vector<cv::Mat>::size_type>(y)] = image.row(y).clone();
+  }
+}
+
+
+/*!
+ * @brief Write back the saved rows to the image
+ * @param [in,out] image      A filled image
+ * @param [in]     savedRows  Original rows which are saved by saveRow()
+ */
+ATTR_NOTHROW inline static void
+restoreRows(cv::Mat &image, const std::vector<cv::Mat> &savedRows) noexcept
+{
+  for (std::vector<cv::Mat>::size_type y = 0; y < savedRows.size(); y++) {
+    if (!savedRows[y].empty()) {
+      cv::Mat row = image.row(static_cast<int>(y));
+      savedRows[y].copyTo(row);
+    }
+  }
+}
+
+
+/*!
+ * @brief Search the area of the filled region in image
+ * @param [in] image    A filled image
+ * @param [in] matcher  Classifier of the color of filled region
+ * @return  Filled region in image
+ */
+ATTR_NOTHROW inline static cv::Rect
+searchArea(const cv::Mat &image, const ColorMatcher &matcher) noexcept
+{
+  CvPoint p1 = {image.cols, image.rows};
+  CvPoint p2 = {0, 0};
+  for (int i = 0; i < image.rows; i++) {
+    for (int j = 0; j < image.cols; j++) {
+      if (isForegroundPixel(matcher, &image.data[i * image.step + j * image.elemSize()])) {
+        if (p1.x > j) p1.x = j;
+        if (p1.y > i) p1.y = i;
+        if (p2.x < j) p2.x = j;
+        if (p2.y < i) p2.y = i;
+      }
+    }
+  }
+  cv::Rect areaRect(p1.x, p1.y, p2.x - p1.x, p2.y - p1.y);
+  return areaRect;
+}
+
+
+/*!
+ * @brief Add blank to filled region
+ * @param [in] imageSize  Size of a filled image
+ * @param [in] roiRect    Filled region in image
+ * @param [in] blank      blank width and height (pixel)
+ * @return  Filled region with blank space
+ */
+ATTR_NOTHROW inline static cv::Rect
+addBlankToRect(const cv::Size &imageSize, const cv::Rect &roiRect, int blank) noexcept
+{
+  if (blank < 1) return roiRect;
+
+  cv::Rect newRoiRect(roiRect.x - blank, roiRect.y - blank, roiRect.width + 2 * blank, roiRect.height + 2 * blank);
+  if (newRoiRect.x < 0) newRoiRect.x = 0;
+  if (newRoiRect.y < 0) newRoiRect.y = 0;
+  if (newRoiRect.x + newRoiRect.width  > imageSize.width)   newRoiRect.width  = imageSize.width  - newRoiRect.x;
+  if (newRoiRect.y + newRoiRect.height > imageSize.height)  newRoiRect.height = imageSize.height - newRoiRect.y;
+  return newRoiRect;
+}
+
+
+/*!
+ * @brief Fill the range of each column in the band for the y-axis base fill
+ * @param [in,out] band       Rows of a image you want to fill
+ * @param [in]     matcher    Classifier of the color of line and area
+ * @param [in]     y0         Position of the first row of the band in the image
+ * @param [in]     firstRows  The first row of specified color in each column (-1 if nothing)
+ * @param [in]     lastRows   The last row of specified color in each column
+ */
+ATTR_NOTHROW inline static void
+fillColumnRanges(cv::Mat &band, const ColorMatcher &matcher, int y0, const std::vector<int> &firstRows, const std::vector<int> &lastRows) noexcept
+{
+  unsigned char foregroundR = static_cast<unsigned char>((matcher.color & R_MASK) >> 16);
+  unsigned char foregroundG = static_cast<unsigned char>((matcher.color & G_MASK) >> 8);
+  unsigned char foregroundB = static_cast<unsigned char>((matcher.color & B_MASK));
+
+  for (int i = 0; i < band.rows; i++) {
+    int y = y0 + i;
+    unsigned char *row = band.ptr<unsigned char>(i);
+    for (int x = 0; x < band.cols; x++) {
+      size_t idx = static_cast<size_t>(x);
+      if (firstRows[idx] == -1 || y <= firstRows[idx] || lastRows[idx] <= y) continue;
+      unsigned char *restrict pixelAddr = &row[3 * x];
+      if (isForegroundPixel(matcher, pixelAddr)) continue;
+      pixelAddr[0] = foregroundB;
+      pixelAddr[1] = foregroundG;
+      pixelAddr[2] = foregroundR;
+    }
+  }
+}
+
+
+
+
+#endif  // FILL_UTIL_H
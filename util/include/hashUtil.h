@@ -0,0 +1,174 @@
+/*!
+ * @brief Provide a fast non-cryptographic hash function (XXH64)
+ *
+ * This is an implementation of XXH64 of xxHash, whose results are identical
+ * to the reference implementation on any endianness.
+ *
+ * @author koturn 0;
+ * @file hashUtil.h
+ */
+#ifndef HASH_UTIL_H
+#define HASH_UTIL_H
+
+#include <cstddef>
+#include "../../include/commonUtil/compat.h"
+
+
+static const unsigned long long XXH64_PRIME1 = 0x9e3779b185ebca87ULL;  //!< Prime 1 of XXH64
+static const unsigned long long XXH64_PRIME2 = 0xc2b2ae3d27d4eb4fULL;  //!< Prime 2 of XXH64
+static const unsigned long long XXH64_PRIME3 = 0x165667b19e3779f9ULL;  //!< Prime 3 of XXH64
+static const unsigned long long XXH64_PRIME4 = 0x85ebca77c2b2ae63ULL;  //!< Prime 4 of XXH64
+static const unsigned long long XXH64_PRIME5 = 0x27d4eb2f165667c5ULL;  //!< Prime 5 of XXH64
+
+
+ATTR_NOTHROW inline static unsigned long long
+calcXxHash64(const void *data, size_t size, unsigned long long seed) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+xxh64Round(unsigned long long acc, unsigned long long input) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+xxh64MergeRound(unsigned long long acc, unsigned long long value) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+rotateLeft64(unsigned long long value, int shift) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+readHashLe64(const unsigned char *p) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+readHashLe32(const unsigned char *p) noexcept;
+
+
+
+
+/*!
+ * @brief Calculate XXH64 of the data
+ * @param [in] data  Address of the data
+ * @param [in] size  Size of the data in bytes
+ * @param [in] seed  Seed of the hash
+ * @return  The hash value
+ */
+ATTR_NOTHROW inline static unsigned long long
+calcXxHash64(const void *data, size_t size, unsigned long long seed) noexcept
+{
+  const unsigned char *p   = static_cast<const unsigned char *>(data);
+  const unsigned char *end = p + size;
+  unsigned long long h;
+  if (size >= 32) {
+    const unsigned char *limit = end - 32;
+    unsigned long long v1 = seed + XXH64_PRIME1 + XXH64_PRIME2;
+    unsigned long long v2 = seed + XXH64_PRIME2;
+    unsigned long long v3 = seed;
+    unsigned long long v4 = seed - XXH64_PRIME1;
+    do {
+      v1 = xxh64Round(v1, readHashLe64(p));
+      v2 = xxh64Round(v2, readHashLe64(p + 8));
+      v3 = xxh64Round(v3, readHashLe64(p + 16));
+      v4 = xxh64Round(v4, readHashLe64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = rotateLeft64(v1, 1) + rotateLeft64(v2, 7) + rotateLeft64(v3, 12) + rotateLeft64(v4, 18);
+    h = xxh64MergeRound(h, v1);
+    h = xxh64MergeRound(h, v2);
+    h = xxh64MergeRound(h, v3);
+    h = xxh64MergeRound(h, v4);
+  } else {
+    h = seed + XXH64_PRIME5;
+  }
+  h += static_cast<unsigned long long>(size);
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= xxh64Round(0, readHashLe64(p));
+    h = rotateLeft64(h, 27) * XXH64_PRIME1 + XXH64_PRIME4;
+  }
+  if (p + 4 <= end) {
+    h ^= readHashLe32(p) * XXH64_PRIME1;
+    h = rotateLeft64(h, 23) * XXH64_PRIME2 + XXH64_PRIME3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h ^= *p * XXH64_PRIME5;
+    h = rotateLeft64(h, 11) * XXH64_PRIME1;
+  }
+
+  h ^= h >> 33;
+  h *= XXH64_PRIME2;
+  h ^= h >> 29;
+  h *= XXH64_PRIME3;
+  h ^= h >> 32;
+  return h;
+}
+
+
+/*!
+ * @brief Mix a lane of input into an accumulator of XXH64
+ * @param [in] acc    The accumulator
+ * @param [in] input  A lane of input
+ * @return  The new accumulator
+ */
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+xxh64Round(unsigned long long acc, unsigned long long input) noexcept
+{
+  acc += input * XXH64_PRIME2;
+  return rotateLeft64(acc, 31) * XXH64_PRIME1;
+}
+
+
+/*!
+ * @brief Merge an accumulator into the hash value of XXH64
+ * @param [in] acc    The hash value
+ * @param [in] value  The accumulator
+ * @return  The new hash value
+ */
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+xxh64MergeRound(unsigned long long acc, unsigned long long value) noexcept
+{
+  acc ^= xxh64Round(0, value);
+  return acc * XXH64_PRIME1 + XXH64_PRIME4;
+}
+
+
+/*!
+ * @brief Rotate the 64-bit value to the left
+ * @param [in] value  A value
+ * @param [in] shift  The number of bits to rotate (1 to 63)
+ * @return  The rotated value
+ */
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+rotateLeft64(unsigned long long value, int shift) noexcept
+{
+  return (value << shift) | (value >> (64 - shift));
+}
+
+
+/*!
+ * @brief Read a little-endian 64-bit value
+ * @param [in] p  Address of the value
+ * @return  The value
+ */
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+readHashLe64(const unsigned char *p) noexcept
+{
+  return readHashLe32(p) | (readHashLe32(p + 4) << 32);
+}
+
+
+/*!
+ * @brief Read a little-endian 32-bit value
+ * @param [in] p  Address of the value
+ * @return  The value
+ */
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+readHashLe32(const unsigned char *p) noexcept
+{
+  return static_cast<unsigned long long>(p[0])
+    | (static_cast<unsigned long long>(p[1]) << 8)
+    | (static_cast<unsigned long long>(p[2]) << 16)
+    | (static_cast<unsigned long long>(p[3]) << 24);
+}
+
+
+
+
+#endif  // HASH_UTIL_H
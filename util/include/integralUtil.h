@@ -0,0 +1,157 @@
+/*!
+ * @brief Provide summed-area tables of the region for the moments over
+ *        arbitrary rectangles
+ *
+ * The tables have (width + 1) * (height + 1) elements, and the element at
+ * (x, y) is the sum over the pixels of the region in [0, x) * [0, y).  The
+ * number of pixels, the sum of x-positions and the sum of y-positions over a
+ * rectangle are obtained from four elements of each table.
+ *
+ * @author koturn 0;
+ * @file integralUtil.h
+ */
+#ifndef INTEGRAL_UTIL_H
+#define INTEGRAL_UTIL_H
+
+#include <algorithm>
+#include <vector>
+#include <opencv/cv.h>
+#include "../../include/commonUtil/compat.h"
+#include "spanUtil.h"
+
+
+//! Summed-area tables of the region
+struct MomentTable {
+  int                    width;   //!< Width of the image
+  int                    height;  //!< Height of the image
+  std::vector<long long> counts;  //!< Summed-area table of the number of pixels
+  std::vector<long long> sumXs;   //!< Summed-area table of x-positions
+  std::vector<long long> sumYs;   //!< Summed-area table of y-positions
+
+  MomentTable() :
+    width(0),
+    height(0),
+    counts(),
+    sumXs(),
+    sumYs()
+  {}
+};
+
+//! Moments of the region in a rectangle up to first order
+typedef struct {
+  long long count;  //!< The number of pixels
+  long long sumX;   //!< Sum of x-positions
+  long long sumY;   //!< Sum of y-positions
+} RectMoments;
+
+
+ATTR_NOTHROW inline static void
+buildMomentTable(MomentTable &table, const SpanIndex &index) noexcept;
+
+ATTR_NOTHROW inline static RectMoments
+queryMomentTable(const MomentTable &table, const cv::Rect &rect) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static long long
+sumRectOfTable(const std::vector<long long> &values, size_t stride, int x0, int y0, int x1, int y1) noexcept;
+
+
+
+
+/*!
+ * @brief Build the summed-area tables of the region
+ *
+ * The prefix sums of the rows are calculated from the spans in parallel,
+ * and then accumulated from the top row to the bottom row.
+ * @param [out] table  Summed-area tables of the region
+ * @param [in]  index  Run-length representation of the region
+ */
+ATTR_NOTHROW inline static void
+buildMomentTable(MomentTable &table, const SpanIndex &index) noexcept
+{
+  size_t stride = static_cast<size_t>(index.width) + 1;
+  size_t size   = stride * (static_cast<size_t>(index.height) + 1);
+  table.width  = index.width;
+  table.height = index.height;
+  table.counts.assign(size, 0);
+  table.sumXs.assign(size, 0);
+  table.sumYs.assign(size, 0);
+
+  #pragma omp parallel for
+  for (int y = 0; y < index.height; y++) {
+    size_t base = stride * (static_cast<size_t>(y) + 1);
+    long long count = 0;
+    long long sumX  = 0;
+    int k = index.rowOffsets[static_cast<size_t>(y)];
+    int kEnd = index.rowOffsets[static_cast<size_t>(y) + 1];
+    for (int x = 0; x < index.width; x++) {
+      while (k < kEnd && index.spans[static_cast<size_t>(k)].end <= x) {
+        k++;
+      }
+      if (k < kEnd && index.spans[static_cast<size_t>(k)].begin <= x) {
+        count++;
+        sumX += x;
+      }
+      table.counts[base + static_cast<size_t>(x) + 1] = count;
+      table.sumXs[base + static_cast<size_t>(x) + 1]  = sumX;
+      table.sumYs[base + static_cast<size_t>(x) + 1]  = count * y;
+    }
+  }
+  for (int y = 1; y < index.height; y++) {
+    size_t prev = stride * static_cast<size_t>(y);
+    size_t base = prev + stride;
+    for (size_t x = 1; x < stride; x++) {
+      table.counts[base + x] += table.counts[prev + x];
+      table.sumXs[base + x]  += table.sumXs[prev + x];
+      table.sumYs[base + x]  += table.sumYs[prev + x];
+    }
+  }
+}
+
+
+/*!
+ * @brief Get the moments of the region in the rectangle
+ *
+ * The rectangle is clipped to the image.
+ * @param [in] table  Summed-area tables of the region
+ * @param [in] rect   A rectangle
+ * @return  The moments of the region in the rectangle
+ */
+ATTR_NOTHROW inline static RectMoments
+queryMomentTable(const MomentTable &table, const cv::Rect &rect) noexcept
+{
+  size_t stride = static_cast<size_t>(table.width) + 1;
+  int x0 = std::min(std::max(rect.x, 0), table.width);
+  int y0 = std::min(std::max(rect.y, 0), table.height);
+  int x1 = std::min(std::max(rect.x + rect.width, x0), table.width);
+  int y1 = std::min(std::max(rect.y + rect.height, y0), table.height);
+  RectMoments moments;
+  moments.count = sumRectOfTable(table.counts, stride, x0, y0, x1, y1);
+  moments.sumX  = sumRectOfTable(table.sumXs, stride, x0, y0, x1, y1);
+  moments.sumY  = sumRectOfTable(table.sumYs, stride, x0, y0, x1, y1);
+  return moments;
+}
+
+
+/*!
+ * @brief Get the sum over [x0, x1) * [y0, y1) from the summed-area table
+ * @param [in] values  A summed-area table
+ * @param [in] stride  The number of elements of a row of the table
+ * @param [in] x0      Left of the rectangle
+ * @param [in] y0      Top of the rectangle
+ * @param [in] x1      Right of the rectangle (exclusive)
+ * @param [in] y1      Bottom of the rectangle (exclusive)
+ * @return  The sum
+ */
+ATTR_NOTHROW ALWAYSINLINE static long long
+sumRectOfTable(const std::vector<long long> &values, size_t stride, int x0, int y0, int x1, int y1) noexcept
+{
+  size_t top    = stride * static_cast<size_t>(y0);
+  size_t bottom = stride * static_cast<size_t>(y1);
+  return values[bottom + static_cast<size_t>(x1)] - values[bottom + static_cast<size_t>(x0)]
+    - values[top + static_cast<size_t>(x1)] + values[top + static_cast<size_t>(x0)];
+}
+
+
+
+
+#endif  // INTEGRAL_UTIL_H
@@ -18,6 +18,9 @@
 ATTR_PURE ATTR_NOTHROW CONSTEXPR_CXX11 ALWAYSINLINE static double
 degreeToRadian(double degree) noexcept;
 
+ATTR_PURE ATTR_NOTHROW CONSTEXPR_CXX11 ALWAYSINLINE static double
+radianToDegree(double radian) noexcept;
+
 template<typename VType>
 ATTR_PURE ATTR_NOTHROW CONSTEXPR_CXX11 ALWAYSINLINE static VType
 clipping(const VType &x, const VType &min, const VType &max) noexcept;
@@ -25,6 +28,9 @@ clipping(const VType &x, const VType &min, const VType &max) noexcept;
 ATTR_PURE ATTR_NOTHROW ALWAYSINLINE static double
 calcDistance(const CvPoint &p1, const CvPoint &p2) noexcept;
 
+ATTR_NOTHROW ALWAYSINLINE static double
+calcDistance(const cv::Point2d &p1, const cv::Point2d &p2) noexcept;
+
 #ifdef _MSC_VER
 ATTR_PURE ATTR_NOTHROW ALWAYSINLINE static double
 round(double x) noexcept;
@@ -62,6 +68,18 @@ degreeToRadian(double degree) noexcept
 }
 
 
+/*!
+ * @brief Convert radian-value to degree-value
+ * @param [in] radian  A radian-value
+ * @return  A degree-value which is converted from radian-value
+ */
+ATTR_PURE ATTR_NOTHROW CONSTEXPR_CXX11 ALWAYSINLINE static double
+radianToDegree(double radian) noexcept
+{
+  return radian * 180 / M_PI;
+}
+
+
 /*!
  * @brief Calculate two-dimensional euclidean distance between first point and
  *        second point
@@ -72,7 +90,23 @@ degreeToRadian(double degree) noexcept
 ATTR_PURE ATTR_NOTHROW ALWAYSINLINE static double
 calcDistance(const CvPoint &p1, const CvPoint &p2) noexcept
 {
-  return std::sqrt(std::pow(p1.x - p2.x, 2.0) + std::pow(p1.y - p2.y, 2.0));
+  int dx = p1.x - p2.x;
+  int dy = p1.y - p2.y;
+  return std::sqrt(static_cast<double>(dx * dx + dy * dy));
+}
+
+
+/*!
+ * @brief Calculate two-dimensional euclidean distance between first point and
+ *        second point
+ * @param [in] p1  First point
+ * @param [in] p2  Second point
+ * @return  two-dimensional euclidean distance between first point and second point
+ */
+ATTR_NOTHROW ALWAYSINLINE static double
+calcDistance(const cv::Point2d &p1, const cv::Point2d &p2) noexcept
+{
+  return std::sqrt((p1.x - p2.x) * (p1.x - p2.x) + (p1.y - p2.y) * (p1.y - p2.y));
 }
 
 
@@ -0,0 +1,255 @@
+/*!
+ * @brief Provide utility functions to map a file into memory read-only, and
+ *        to create a file of the fixed size which is mapped writable
+ *
+ * CreateFileMapping() / MapViewOfFile() are used on Windows, and mmap() is
+ * used on the others.
+ *
+ * @author koturn 0;
+ * @file mmapUtil.h
+ */
+#ifndef MMAP_UTIL_H
+#define MMAP_UTIL_H
+
+#include <cstddef>
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+#include "../../include/commonUtil/compat.h"
+
+
+//! A file which is mapped into memory
+typedef struct {
+  const unsigned char *data;  //!< Address of the mapped file (nullptr if the file is empty)
+  size_t               size;  //!< Size of the file in bytes
+#ifdef _WIN32
+  HANDLE               hFile;     //!< Handle of the file
+  HANDLE               hMapping;  //!< Handle of the file mapping object
+#else
+  int                  fd;        //!< File descriptor
+#endif
+} MappedFile;
+
+//! A file which is created and mapped into memory writable
+typedef struct {
+  unsigned char *data;  //!< Address of the mapped file (nullptr if the file is empty)
+  size_t         size;  //!< Size of the file in bytes
+#ifdef _WIN32
+  HANDLE         hFile;     //!< Handle of the file
+  HANDLE         hMapping;  //!< Handle of the file mapping object
+#else
+  int            fd;        //!< File descriptor
+#endif
+} WritableMappedFile;
+
+
+ATTR_NOTHROW inline static bool
+openMappedFile(MappedFile &mappedFile, const char *filename) noexcept;
+
+ATTR_NOTHROW inline static void
+closeMappedFile(MappedFile &mappedFile) noexcept;
+
+ATTR_NOTHROW inline static bool
+createMappedFile(WritableMappedFile &mappedFile, const char *filename, size_t size) noexcept;
+
+ATTR_NOTHROW inline static bool
+closeWritableMappedFile(WritableMappedFile &mappedFile) noexcept;
+
+
+
+
+/*!
+ * @brief Map the whole of the file into memory read-only
+ * @param [out] mappedFile  The mapped file
+ * @param [in]  filename    A name of the file
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+openMappedFile(MappedFile &mappedFile, const char *filename) noexcept
+{
+  mappedFile.data = nullptr;
+  mappedFile.size = 0;
+#ifdef _WIN32
+  mappedFile.hMapping = nullptr;
+  mappedFile.hFile    = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (mappedFile.hFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(mappedFile.hFile, &fileSize)) {
+    closeMappedFile(mappedFile);
+    return false;
+  }
+  mappedFile.size = static_cast<size_t>(fileSize.QuadPart);
+  if (mappedFile.size == 0) {
+    return true;
+  }
+  mappedFile.hMapping = CreateFileMappingA(mappedFile.hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappedFile.hMapping == nullptr) {
+    closeMappedFile(mappedFile);
+    return false;
+  }
+  mappedFile.data = static_cast<const unsigned char *>(MapViewOfFile(mappedFile.hMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+  mappedFile.fd = open(filename, O_RDONLY);
+  if (mappedFile.fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(mappedFile.fd, &st) == -1) {
+    closeMappedFile(mappedFile);
+    return false;
+  }
+  mappedFile.size = static_cast<size_t>(st.st_size);
+  if (mappedFile.size == 0) {
+    return true;
+  }
+  void *addr = mmap(nullptr, mappedFile.size, PROT_READ, MAP_SHARED, mappedFile.fd, 0);
+  mappedFile.data = addr == MAP_FAILED ? nullptr : static_cast<const unsigned char *>(addr);
+#endif
+  if (mappedFile.data == nullptr) {
+    closeMappedFile(mappedFile);
+    return false;
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Unmap the file and close it
+ * @param [in,out] mappedFile  The mapped file
+ */
+ATTR_NOTHROW inline static void
+closeMappedFile(MappedFile &mappedFile) noexcept
+{
+#ifdef _WIN32
+  if (mappedFile.data != nullptr) {
+    UnmapViewOfFile(mappedFile.data);
+  }
+  if (mappedFile.hMapping != nullptr) {
+    CloseHandle(mappedFile.hMapping);
+    mappedFile.hMapping = nullptr;
+  }
+  if (mappedFile.hFile != INVALID_HANDLE_VALUE) {
+    CloseHandle(mappedFile.hFile);
+    mappedFile.hFile = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (mappedFile.data != nullptr) {
+    munmap(const_cast<unsigned char *>(mappedFile.data), mappedFile.size);
+  }
+  if (mappedFile.fd != -1) {
+    close(mappedFile.fd);
+    mappedFile.fd = -1;
+  }
+#endif
+  mappedFile.data = nullptr;
+  mappedFile.size = 0;
+}
+
+
+/*!
+ * @brief Create the file of the size and map the whole of it into memory
+ *        writable
+ *
+ * The file is truncated if it exists.  The contents are undefined until they
+ * are written through the mapping.
+ * @param [out] mappedFile  The mapped file
+ * @param [in]  filename    A name of the file
+ * @param [in]  size        Size of the file in bytes
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+createMappedFile(WritableMappedFile &mappedFile, const char *filename, size_t size) noexcept
+{
+  mappedFile.data = nullptr;
+  mappedFile.size = size;
+#ifdef _WIN32
+  mappedFile.hMapping = nullptr;
+  mappedFile.hFile    = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (mappedFile.hFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  if (size == 0) {
+    return true;
+  }
+  unsigned long long fileSize = static_cast<unsigned long long>(size);
+  mappedFile.hMapping = CreateFileMappingA(mappedFile.hFile, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(fileSize >> 32), static_cast<DWORD>(fileSize & 0xffffffffULL), nullptr);
+  if (mappedFile.hMapping == nullptr) {
+    closeWritableMappedFile(mappedFile);
+    return false;
+  }
+  mappedFile.data = static_cast<unsigned char *>(MapViewOfFile(mappedFile.hMapping, FILE_MAP_WRITE, 0, 0, 0));
+#else
+  mappedFile.fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (mappedFile.fd == -1) {
+    return false;
+  }
+  if (size == 0) {
+    return true;
+  }
+  if (ftruncate(mappedFile.fd, static_cast<off_t>(size)) == -1) {
+    closeWritableMappedFile(mappedFile);
+    return false;
+  }
+  void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mappedFile.fd, 0);
+  mappedFile.data = addr == MAP_FAILED ? nullptr : static_cast<unsigned char *>(addr);
+#endif
+  if (mappedFile.data == nullptr) {
+    closeWritableMappedFile(mappedFile);
+    return false;
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Write back the mapped contents, unmap the file and close it
+ * @param [in,out] mappedFile  The mapped file
+ * @return  true if the contents are written back, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+closeWritableMappedFile(WritableMappedFile &mappedFile) noexcept
+{
+  bool isSucceeded = true;
+#ifdef _WIN32
+  if (mappedFile.data != nullptr) {
+    isSucceeded = FlushViewOfFile(mappedFile.data, 0) != 0;
+    UnmapViewOfFile(mappedFile.data);
+  }
+  if (mappedFile.hMapping != nullptr) {
+    CloseHandle(mappedFile.hMapping);
+    mappedFile.hMapping = nullptr;
+  }
+  if (mappedFile.hFile != INVALID_HANDLE_VALUE) {
+    CloseHandle(mappedFile.hFile);
+    mappedFile.hFile = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (mappedFile.data != nullptr) {
+    isSucceeded = msync(mappedFile.data, mappedFile.size, MS_SYNC) == 0;
+    munmap(mappedFile.data, mappedFile.size);
+  }
+  if (mappedFile.fd != -1) {
+    isSucceeded = close(mappedFile.fd) == 0 && isSucceeded;
+    mappedFile.fd = -1;
+  }
+#endif
+  mappedFile.data = nullptr;
+  mappedFile.size = 0;
+  return isSucceeded;
+}
+
+
+
+
+#endif  // MMAP_UTIL_H
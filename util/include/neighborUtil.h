@@ -0,0 +1,74 @@
+/*!
+ * @brief Provide utility functions to keep the K nearest candidates in a
+ *        bounded max-heap
+ *
+ * The farthest candidate is at the top of the heap, so that a new candidate
+ * is compared with only it.  The candidates of the same distance are ordered
+ * by their indices.
+ *
+ * @author koturn 0;
+ * @file neighborUtil.h
+ */
+#ifndef NEIGHBOR_UTIL_H
+#define NEIGHBOR_UTIL_H
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "../../include/commonUtil/compat.h"
+
+
+//! A candidate of the nearest items, which is ordered by the distance and the index
+typedef std::pair<float, unsigned int> Neighbor;
+
+
+inline static void
+pushNeighbor(std::vector<Neighbor> &heap, size_t k, const Neighbor &neighbor);
+
+ATTR_NOTHROW ALWAYSINLINE static float
+getHeapLimit(const std::vector<Neighbor> &heap, size_t k) noexcept;
+
+
+
+
+/*!
+ * @brief Offer a candidate to the max-heap of the K nearest candidates
+ *
+ * If the heap is full, the candidate replaces the farthest one only if it is
+ * nearer than that.
+ * @param [in,out] heap      Max-heap of the candidates
+ * @param [in]     k         The number of the candidates to keep
+ * @param [in]     neighbor  A candidate
+ */
+inline static void
+pushNeighbor(std::vector<Neighbor> &heap, size_t k, const Neighbor &neighbor)
+{
+  if (heap.size() < k) {
+    heap.push_back(neighbor);
+    std::push_heap(heap.begin(), heap.end());
+  } else if (k > 0 && neighbor < heap.front()) {
+    std::pop_heap(heap.begin(), heap.end());
+    heap.back() = neighbor;
+    std::push_heap(heap.begin(), heap.end());
+  }
+}
+
+
+/*!
+ * @brief Get the distance which a candidate must be less than to enter the
+ *        max-heap of the K nearest candidates
+ * @param [in] heap  Max-heap of the candidates
+ * @param [in] k     The number of the candidates to keep
+ * @return  The distance of the K-th candidate, or infinity if the heap is not full
+ */
+ATTR_NOTHROW ALWAYSINLINE static float
+getHeapLimit(const std::vector<Neighbor> &heap, size_t k) noexcept
+{
+  return heap.size() < k || heap.empty() ? std::numeric_limits<float>::infinity() : heap.front().first;
+}
+
+
+
+
+#endif  // NEIGHBOR_UTIL_H
@@ -0,0 +1,203 @@
+/*!
+ * @brief Provide utility functions to read and write binary PPM files
+ *        row by row
+ *
+ * These functions enable to process images which are too large to load on
+ * the memory at once.
+ *
+ * @author koturn 0;
+ * @file pnmUtil.h
+ */
+#ifndef PNM_UTIL_H
+#define PNM_UTIL_H
+
+#include <cctype>
+#include <cstdio>
+#include <vector>
+#include <opencv/cv.h>
+#include "../../include/commonUtil/compat.h"
+
+
+//! Stream of binary PPM (P6) file
+typedef struct {
+  std::FILE *fp;      //!< File pointer
+  int        width;   //!< Width of the image
+  int        height;  //!< Height of the image
+} PnmStream;
+
+
+ATTR_NOTHROW inline static bool
+openPnmReader(PnmStream &stream, const char *filename) noexcept;
+
+ATTR_NOTHROW inline static bool
+openPnmWriter(PnmStream &stream, const char *filename, int width, int height) noexcept;
+
+ATTR_NOTHROW inline static bool
+readPnmRows(PnmStream &stream, cv::Mat &band) noexcept;
+
+ATTR_NOTHROW inline static bool
+writePnmRows(PnmStream &stream, const cv::Mat &band, int x, int width) noexcept;
+
+ATTR_NOTHROW inline static void
+closePnm(PnmStream &stream) noexcept;
+
+ATTR_NOTHROW inline static bool
+readPnmHeaderValue(std::FILE *fp, int &value) noexcept;
+
+
+
+
+/*!
+ * @brief Open binary PPM file and read its header
+ * @param [out] stream    Stream of binary PPM file
+ * @param [in]  filename  A name of binary PPM file
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+openPnmReader(PnmStream &stream, const char *filename) noexcept
+{
+  stream.fp = std::fopen(filename, "rb");
+  if (stream.fp == nullptr) {
+    return false;
+  }
+  int maxValue;
+  if (std::fgetc(stream.fp) != 'P' || std::fgetc(stream.fp) != '6'
+      || !readPnmHeaderValue(stream.fp, stream.width)
+      || !readPnmHeaderValue(stream.fp, stream.height)
+      || !readPnmHeaderValue(stream.fp, maxValue)
+      || maxValue != 255) {
+    closePnm(stream);
+    return false;
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Open binary PPM file and write its header
+ * @param [out] stream    Stream of binary PPM file
+ * @param [in]  filename  A name of binary PPM file
+ * @param [in]  width     Width of the image
+ * @param [in]  height    Height of the image
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+openPnmWriter(PnmStream &stream, const char *filename, int width, int height) noexcept
+{
+  stream.fp = std::fopen(filename, "wb");
+  if (stream.fp == nullptr) {
+    return false;
+  }
+  stream.width  = width;
+  stream.height = height;
+  if (std::fprintf(stream.fp, "P6\n%d %d\n255\n", width, height) < 0) {
+    closePnm(stream);
+    return false;
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Read next rows from binary PPM file
+ *
+ * The pixels are stored in BGR order, as same as cv::imread().
+ * @param [in,out] stream  Stream of binary PPM file
+ * @param [out]    band    Destination image.  Its rows is the number of rows
+ *                         to read and its type must be CV_8UC3.
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+readPnmRows(PnmStream &stream, cv::Mat &band) noexcept
+{
+  for (int y = 0; y < band.rows; y++) {
+    unsigned char *row = band.ptr<unsigned char>(y);
+    if (std::fread(row, 3, static_cast<size_t>(stream.width), stream.fp) != static_cast<size_t>(stream.width)) {
+      return false;
+    }
+    for (int x = 0; x < stream.width; x++) {
+      unsigned char tmp = row[3 * x];
+      row[3 * x]        = row[3 * x + 2];
+      row[3 * x + 2]    = tmp;
+    }
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Write rows to binary PPM file
+ * @param [in,out] stream  Stream of binary PPM file
+ * @param [in]     band    Source image in BGR order
+ * @param [in]     x       Left position of the columns to write
+ * @param [in]     width   The number of columns to write
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+writePnmRows(PnmStream &stream, const cv::Mat &band, int x, int width) noexcept
+{
+  std::vector<unsigned char> buffer(static_cast<size_t>(width) * 3);
+  for (int y = 0; y < band.rows; y++) {
+    const unsigned char *row = band.ptr<unsigned char>(y) + 3 * x;
+    for (int i = 0; i < width; i++) {
+      buffer[3 * static_cast<size_t>(i)]     = row[3 * i + 2];
+      buffer[3 * static_cast<size_t>(i) + 1] = row[3 * i + 1];
+      buffer[3 * static_cast<size_t>(i) + 2] = row[3 * i];
+    }
+    if (std::fwrite(&buffer[0], 3, static_cast<size_t>(width), stream.fp) != static_cast<size_t>(width)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Close the stream of binary PPM file
+ * @param [in,out] stream  Stream of binary PPM file
+ */
+ATTR_NOTHROW inline static void
+closePnm(PnmStream &stream) noexcept
+{
+  if (stream.fp != nullptr) {
+    std::fclose(stream.fp);
+    stream.fp = nullptr;
+  }
+}
+
+
+/*!
+ * @brief Read a decimal value in the header of binary PPM file
+ *
+ * Comments in the header are skipped, and one whitespace after the value is
+ * consumed.
+ * @param [in]  fp     File pointer
+ * @param [out] value  Read value
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+readPnmHeaderValue(std::FILE *fp, int &value) noexcept
+{
+  int c;
+  do {
+    c = std::fgetc(fp);
+    if (c == '#') {
+      while (c != '\n' && c != EOF) {
+        c = std::fgetc(fp);
+      }
+    }
+  } while (c != EOF && std::isspace(c));
+  if (c == EOF || !std::isdigit(c)) {
+    return false;
+  }
+  value = 0;
+  for (; c != EOF && std::isdigit(c); c = std::fgetc(fp)) {
+    value = value * 10 + (c - '0');
+  }
+  return c != EOF && std::isspace(c);
+}
+
+
+
+
+#endif  // PNM_UTIL_H
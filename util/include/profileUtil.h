@@ -0,0 +1,693 @@
+/*!
+ * @brief Provide utility functions to read and write radial profiles in the
+ *        binary format
+ *
+ * A profile file consists of a file header and records which are appended
+ * one after another.  All values are little-endian and every part of a record
+ * is aligned to 8 bytes, so that the columns can be read directly from the
+ * file mapped into memory on little-endian machines.
+ *
+ *   File header (16 bytes)
+ *     char[8]   magic "EVPROF\0\0"
+ *     uint32    version
+ *     uint32    reserved (0)
+ *   Record
+ *     uint32    length of the name
+ *     uint32    the number of columns
+ *     uint64    the number of points
+ *     uint32    the number of scalars
+ *     uint32    reserved (0)
+ *     char[]    name, which is padded with '\0' to a multiple of 8 bytes
+ *     float64[] columns (column-major: all points of the first column, ...)
+ *     float64[] scalars
+ *
+ * The columns of evalArea are angle, distance, x and y in this order.  The
+ * readers must skip unknown columns and scalars by the counts in the record
+ * header, so that new ones can be added at the end without breaking them.
+ *
+ * The offsets of the records are also appended to the index file, whose name
+ * is the name of the profile file followed by ".idx".
+ *
+ *   Index header (16 bytes)
+ *     char[8]   magic "EVPIDX\0\0"
+ *     uint32    version
+ *     uint32    reserved (0)
+ *   uint64[]    offsets of the records
+ *
+ * @author koturn 0;
+ * @file profileUtil.h
+ */
+#ifndef PROFILE_UTIL_H
+#define PROFILE_UTIL_H
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../../include/commonUtil/compat.h"
+#include "mmapUtil.h"
+
+
+static const char     PROFILE_MAGIC[8]       = {'E', 'V', 'P', 'R', 'O', 'F', '\0', '\0'};  //!< Magic of the profile file
+static const char     PROFILE_INDEX_MAGIC[8] = {'E', 'V', 'P', 'I', 'D', 'X', '\0', '\0'};  //!< Magic of the index file
+static const unsigned PROFILE_VERSION        = 2;   //!< Version of the format
+static const size_t   PROFILE_HEADER_SIZE    = 16;  //!< Size of the file header and the index header
+static const size_t   PROFILE_RECORD_SIZE    = 24;  //!< Size of the record header
+
+//! Columns of the profile which evalArea writes
+enum {
+  PROFILE_COLUMN_ANGLE,     //!< Angle in degree
+  PROFILE_COLUMN_DISTANCE,  //!< Distance from the center of gravity
+  PROFILE_COLUMN_X,         //!< X-position of the boundary
+  PROFILE_COLUMN_Y,         //!< Y-position of the boundary
+  PROFILE_N_COLUMNS         //!< The number of columns
+};
+
+//! Scalars of the profile which evalArea writes, which may be followed by Fourier descriptor
+enum {
+  PROFILE_SCALAR_MIN_RADIUS,    //!< Minimum distance
+  PROFILE_SCALAR_MAX_RADIUS,    //!< Maximum distance
+  PROFILE_SCALAR_MEAN_RADIUS,   //!< Mean of the distances
+  PROFILE_SCALAR_STD_RADIUS,    //!< Standard deviation of the distances
+  PROFILE_SCALAR_RADIUS_RATIO,  //!< Ratio of the minimum distance to the maximum distance
+  PROFILE_SCALAR_CIRCULARITY,   //!< 4 * pi * area / perimeter^2
+  PROFILE_SCALAR_AREA,          //!< Area of the region (m00)
+  PROFILE_SCALAR_CENTROID_X,    //!< X-position of the center of gravity
+  PROFILE_SCALAR_CENTROID_Y,    //!< Y-position of the center of gravity
+  PROFILE_SCALAR_MAJOR_AXIS,    //!< Semi-major axis of the ellipse which has the same second moments
+  PROFILE_SCALAR_MINOR_AXIS,    //!< Semi-minor axis of the ellipse which has the same second moments
+  PROFILE_SCALAR_ORIENTATION,   //!< Angle between x-axis and major axis (degree, clockwise in image)
+  PROFILE_SCALAR_ECCENTRICITY,  //!< Eccentricity of the ellipse which has the same second moments
+  PROFILE_N_SCALARS             //!< The number of scalars
+};
+
+//! The first scalar of the moments and the shape features
+static const size_t PROFILE_FEATURE_BEGIN = PROFILE_SCALAR_AREA;
+
+//! Writer which appends records to the profile file and the index file
+typedef struct {
+  std::FILE          *fp;       //!< File pointer of the profile file
+  std::FILE          *indexFp;  //!< File pointer of the index file
+  unsigned long long  offset;   //!< Offset of the next record
+} ProfileWriter;
+
+//! A record in the mapped profile file
+typedef struct {
+  const char          *name;        //!< Name of the record (not terminated with '\0')
+  size_t               nameLength;  //!< Length of the name
+  size_t               nColumns;    //!< The number of columns
+  size_t               nPoints;     //!< The number of points
+  size_t               nScalars;    //!< The number of scalars
+  const unsigned char *columns;     //!< Address of the first column
+  const unsigned char *scalars;     //!< Address of the first scalar
+} ProfileRecordView;
+
+
+ATTR_NOTHROW inline static bool
+openProfileWriter(ProfileWriter &writer, const char *filename) noexcept;
+
+ATTR_NOTHROW inline static bool
+writeProfileRecord(
+    ProfileWriter &writer,
+    const std::string &name,
+    const double *const columns[],
+    size_t nColumns,
+    size_t nPoints,
+    const double *scalars,
+    size_t nScalars);
+
+ATTR_NOTHROW inline static void
+closeProfileWriter(ProfileWriter &writer) noexcept;
+
+ATTR_NOTHROW inline static bool
+listProfileRecords(const MappedFile &file, const char *filename, std::vector<unsigned long long> &offsets);
+
+ATTR_NOTHROW inline static bool
+parseProfileRecord(const MappedFile &file, unsigned long long offset, ProfileRecordView &view) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static double
+getProfileValue(const ProfileRecordView &view, size_t column, size_t i) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static double
+getProfileScalar(const ProfileRecordView &view, size_t i) noexcept;
+
+ATTR_NOTHROW inline static bool
+resampleProfileRecord(const ProfileRecordView &view, int nPoints, float *resampled) noexcept;
+
+ATTR_NOTHROW inline static void
+normalizeProfile(float *values, int nPoints) noexcept;
+
+ATTR_NOTHROW inline static void
+writeProfileCsv(std::FILE *fp, const std::vector<double> &distances, double degreeStep) noexcept;
+
+ATTR_NOTHROW inline static void
+writeAngleProfileCsv(std::FILE *fp, const std::vector<double> &angles, const std::vector<double> &distances, double degreeStep) noexcept;
+
+ATTR_NOTHROW inline static int
+countAngleDecimals(double degreeStep) noexcept;
+
+ATTR_NOTHROW inline static unsigned long long
+tellProfileFile(std::FILE *fp) noexcept;
+
+ATTR_NOTHROW inline static size_t
+alignProfileSize(size_t size) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static void
+putLe32(unsigned char *buf, unsigned long value) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static void
+putLe64(unsigned char *buf, unsigned long long value) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static void
+putLeDouble(unsigned char *buf, double value) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static void
+putLeFloat(unsigned char *buf, float value) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static unsigned long
+getLe32(const unsigned char *buf) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+getLe64(const unsigned char *buf) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static double
+getLeDouble(const unsigned char *buf) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static float
+getLeFloat(const unsigned char *buf) noexcept;
+
+
+
+
+/*!
+ * @brief Open the profile file and the index file to append records
+ *
+ * The headers are written if the files are empty.  Otherwise their headers
+ * are checked, so that no record is appended to the file of another version.
+ * @param [out] writer    Writer of the profile file
+ * @param [in]  filename  A name of the profile file
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+openProfileWriter(ProfileWriter &writer, const char *filename) noexcept
+{
+  writer.fp      = std::fopen(filename, "a+b");
+  writer.indexFp = std::fopen((std::string(filename) + ".idx").c_str(), "a+b");
+  writer.offset  = 0;
+  if (writer.fp == nullptr || writer.indexFp == nullptr) {
+    closeProfileWriter(writer);
+    return false;
+  }
+  unsigned char header[PROFILE_HEADER_SIZE] = {0};
+  putLe32(&header[8], PROFILE_VERSION);
+  std::FILE *fps[] = {writer.fp, writer.indexFp};
+  const char *magics[] = {PROFILE_MAGIC, PROFILE_INDEX_MAGIC};
+  for (size_t i = 0; i < 2; i++) {
+    std::fseek(fps[i], 0, SEEK_END);
+    if (tellProfileFile(fps[i]) != 0) {
+      unsigned char existing[PROFILE_HEADER_SIZE];
+      std::rewind(fps[i]);
+      if (std::fread(existing, 1, sizeof(existing), fps[i]) != sizeof(existing)
+          || std::memcmp(existing, magics[i], sizeof(PROFILE_MAGIC)) != 0
+          || getLe32(existing + 8) != PROFILE_VERSION) {
+        closeProfileWriter(writer);
+        return false;
+      }
+      std::fseek(fps[i], 0, SEEK_END);
+      continue;
+    }
+    std::memcpy(header, magics[i], sizeof(PROFILE_MAGIC));
+    if (std::fwrite(header, 1, sizeof(header), fps[i]) != sizeof(header)) {
+      closeProfileWriter(writer);
+      return false;
+    }
+  }
+  writer.offset = tellProfileFile(writer.fp);
+  return true;
+}
+
+
+/*!
+ * @brief Append a record to the profile file and its offset to the index file
+ * @param [in,out] writer    Writer of the profile file
+ * @param [in]     name      Name of the record (e.g. the name of the image)
+ * @param [in]     columns   Addresses of the columns, each of which has nPoints values
+ * @param [in]     nColumns  The number of columns
+ * @param [in]     nPoints   The number of points
+ * @param [in]     scalars   Scalars of the record
+ * @param [in]     nScalars  The number of scalars
+ * @return  true if succeeded, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+writeProfileRecord(
+    ProfileWriter &writer,
+    const std::string &name,
+    const double *const columns[],
+    size_t nColumns,
+    size_t nPoints,
+    const double *scalars,
+    size_t nScalars)
+{
+  size_t nameSize = alignProfileSize(name.size());
+  std::vector<unsigned char> buffer(PROFILE_RECORD_SIZE + nameSize + 8 * (nColumns * nPoints + nScalars), 0);
+  unsigned char *p = &buffer[0];
+  putLe32(p, static_cast<unsigned long>(name.size()));
+  putLe32(p + 4, static_cast<unsigned long>(nColumns));
+  putLe64(p + 8, nPoints);
+  putLe32(p + 16, static_cast<unsigned long>(nScalars));
+  p += PROFILE_RECORD_SIZE;
+  if (!name.empty()) {
+    std::memcpy(p, name.data(), name.size());
+  }
+  p += nameSize;
+  for (size_t j = 0; j < nColumns; j++) {
+    for (size_t i = 0; i < nPoints; i++, p += 8) {
+      putLeDouble(p, columns[j][i]);
+    }
+  }
+  for (size_t i = 0; i < nScalars; i++, p += 8) {
+    putLeDouble(p, scalars[i]);
+  }
+
+  unsigned char entry[8];
+  putLe64(entry, writer.offset);
+  if (std::fwrite(&buffer[0], 1, buffer.size(), writer.fp) != buffer.size()
+      || std::fwrite(entry, 1, sizeof(entry), writer.indexFp) != sizeof(entry)) {
+    return false;
+  }
+  writer.offset += buffer.size();
+  return true;
+}
+
+
+/*!
+ * @brief Close the profile file and the index file
+ * @param [in,out] writer  Writer of the profile file
+ */
+ATTR_NOTHROW inline static void
+closeProfileWriter(ProfileWriter &writer) noexcept
+{
+  if (writer.fp != nullptr) {
+    std::fclose(writer.fp);
+    writer.fp = nullptr;
+  }
+  if (writer.indexFp != nullptr) {
+    std::fclose(writer.indexFp);
+    writer.indexFp = nullptr;
+  }
+}
+
+
+/*!
+ * @brief List the offsets of the records in the mapped profile file
+ *
+ * The index file is used if it exists and it is consistent with the profile
+ * file, that is, each listed record starts where the previous one ends and the
+ * last one ends at the end of the profile file.  Otherwise, for example when
+ * the index file lags behind the profile file, the records are scanned from
+ * the beginning.
+ * @param [in]  file      The mapped profile file
+ * @param [in]  filename  A name of the profile file
+ * @param [out] offsets   Offsets of the records
+ * @return  true if the profile file is valid, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+listProfileRecords(const MappedFile &file, const char *filename, std::vector<unsigned long long> &offsets)
+{
+  offsets.clear();
+  if (file.size < PROFILE_HEADER_SIZE || std::memcmp(file.data, PROFILE_MAGIC, sizeof(PROFILE_MAGIC)) != 0
+      || getLe32(file.data + 8) != PROFILE_VERSION) {
+    return false;
+  }
+
+  ProfileRecordView view;
+  MappedFile indexFile;
+  if (openMappedFile(indexFile, (std::string(filename) + ".idx").c_str())) {
+    bool isValid = indexFile.size >= PROFILE_HEADER_SIZE
+      && std::memcmp(indexFile.data, PROFILE_INDEX_MAGIC, sizeof(PROFILE_INDEX_MAGIC)) == 0;
+    unsigned long long end = PROFILE_HEADER_SIZE;
+    for (size_t pos = PROFILE_HEADER_SIZE; isValid && pos + 8 <= indexFile.size; pos += 8) {
+      offsets.push_back(getLe64(indexFile.data + pos));
+      isValid = offsets.back() == end && parseProfileRecord(file, offsets.back(), view);
+      if (isValid) {
+        end = static_cast<unsigned long long>(view.scalars - file.data) + 8 * view.nScalars;
+      }
+    }
+    closeMappedFile(indexFile);
+    if (isValid && end == file.size) {
+      return true;
+    }
+    offsets.clear();
+  }
+
+  unsigned long long offset = PROFILE_HEADER_SIZE;
+  while (offset < file.size) {
+    if (!parseProfileRecord(file, offset, view)) {
+      return false;
+    }
+    offsets.push_back(offset);
+    offset = static_cast<unsigned long long>(view.scalars - file.data) + 8 * view.nScalars;
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Parse the record at the specified offset in the mapped profile file
+ * @param [in]  file    The mapped profile file
+ * @param [in]  offset  Offset of the record
+ * @param [out] view    The parsed record, which points into the mapped file
+ * @return  true if the record is in the file, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+parseProfileRecord(const MappedFile &file, unsigned long long offset, ProfileRecordView &view) noexcept
+{
+  if (offset < PROFILE_HEADER_SIZE || offset % 8 != 0 || file.size < PROFILE_RECORD_SIZE
+      || offset > file.size - PROFILE_RECORD_SIZE) {
+    return false;
+  }
+  const unsigned char *p = file.data + offset;
+  view.nameLength = getLe32(p);
+  view.nColumns   = getLe32(p + 4);
+  view.nPoints    = static_cast<size_t>(getLe64(p + 8));
+  view.nScalars   = getLe32(p + 16);
+  view.name       = reinterpret_cast<const char *>(p + PROFILE_RECORD_SIZE);
+
+  unsigned long long rest = file.size - offset - PROFILE_RECORD_SIZE;
+  unsigned long long nameSize = alignProfileSize(view.nameLength);
+  if (nameSize > rest || view.nPoints > rest / 8 || (view.nColumns != 0 && view.nPoints > rest / 8 / view.nColumns)) {
+    return false;
+  }
+  unsigned long long nValues = static_cast<unsigned long long>(view.nColumns) * view.nPoints + view.nScalars;
+  if (nValues > (rest - nameSize) / 8) {
+    return false;
+  }
+  view.columns = p + PROFILE_RECORD_SIZE + nameSize;
+  view.scalars = view.columns + 8 * view.nColumns * view.nPoints;
+  return true;
+}
+
+
+/*!
+ * @brief Get a value in the column of the record
+ * @param [in] view    A record
+ * @param [in] column  Index of the column
+ * @param [in] i       Index of the point
+ * @return  The value
+ */
+ATTR_NOTHROW ALWAYSINLINE static double
+getProfileValue(const ProfileRecordView &view, size_t column, size_t i) noexcept
+{
+  return getLeDouble(view.columns + 8 * (column * view.nPoints + i));
+}
+
+
+/*!
+ * @brief Get a scalar of the record
+ * @param [in] view  A record
+ * @param [in] i     Index of the scalar
+ * @return  The scalar
+ */
+ATTR_NOTHROW ALWAYSINLINE static double
+getProfileScalar(const ProfileRecordView &view, size_t i) noexcept
+{
+  return getLeDouble(view.scalars + 8 * i);
+}
+
+
+/*!
+ * @brief Resample the distances of the record to the angles of the same step
+ *
+ * The angles of the record may not be uniform (e.g. the records of the
+ * adaptive sampling of evalArea), so that the distances are interpolated
+ * linearly between the neighboring angles on the circle.
+ * @param [in]  view       A record
+ * @param [in]  nPoints    The number of angles to resample to
+ * @param [out] resampled  The resampled distances (nPoints values)
+ * @return  true if the record has the columns of angle and distance, otherwise false
+ */
+ATTR_NOTHROW inline static bool
+resampleProfileRecord(const ProfileRecordView &view, int nPoints, float *resampled) noexcept
+{
+  if (view.nColumns <= PROFILE_COLUMN_DISTANCE || view.nPoints == 0) {
+    return false;
+  }
+  size_t n = view.nPoints;
+  double firstAngle    = getProfileValue(view, PROFILE_COLUMN_ANGLE, 0);
+  double lastAngle     = getProfileValue(view, PROFILE_COLUMN_ANGLE, n - 1);
+  double firstDistance = getProfileValue(view, PROFILE_COLUMN_DISTANCE, 0);
+  double lastDistance  = getProfileValue(view, PROFILE_COLUMN_DISTANCE, n - 1);
+  size_t j = 0;
+  for (int i = 0; i < nPoints; i++) {
+    double angle = 360.0 * i / nPoints;
+    while (j < n && getProfileValue(view, PROFILE_COLUMN_ANGLE, j) <= angle) {
+      j++;
+    }
+    // Interpolate between [j - 1] and [j], which wrap around the circle
+    double a0 = j == 0 ? lastAngle - 360.0 : getProfileValue(view, PROFILE_COLUMN_ANGLE, j - 1);
+    double d0 = j == 0 ? lastDistance : getProfileValue(view, PROFILE_COLUMN_DISTANCE, j - 1);
+    double a1 = j == n ? firstAngle + 360.0 : getProfileValue(view, PROFILE_COLUMN_ANGLE, j);
+    double d1 = j == n ? firstDistance : getProfileValue(view, PROFILE_COLUMN_DISTANCE, j);
+    double t  = a1 - a0 > 0.0 ? (angle - a0) / (a1 - a0) : 0.0;
+    resampled[i] = static_cast<float>(d0 + (d1 - d0) * t);
+  }
+  return true;
+}
+
+
+/*!
+ * @brief Divide the resampled distances by their mean so that the size of
+ *        the shape is ignored
+ *
+ * The distances are left as they are if the mean is not positive.
+ * @param [in,out] values   The resampled distances
+ * @param [in]     nPoints  The number of the distances
+ */
+ATTR_NOTHROW inline static void
+normalizeProfile(float *values, int nPoints) noexcept
+{
+  double sum = 0.0;
+  for (int i = 0; i < nPoints; i++) {
+    sum += values[i];
+  }
+  double mean = sum / nPoints;
+  if (mean <= 0.0) {
+    return;
+  }
+  for (int i = 0; i < nPoints; i++) {
+    values[i] = static_cast<float>(values[i] / mean);
+  }
+}
+
+
+/*!
+ * @brief Write the distances with their angles in csv-format
+ *
+ * The angles are formatted with the number of decimal places of degreeStep,
+ * and the integer part is padded to three digits with zero.
+ * @param [in] fp          File pointer of output
+ * @param [in] distances   The distances for each angle
+ * @param [in] degreeStep  Angular step in degree
+ */
+ATTR_NOTHROW inline static void
+writeProfileCsv(std::FILE *fp, const std::vector<double> &distances, double degreeStep) noexcept
+{
+  int precision = countAngleDecimals(degreeStep);
+  int width = precision == 0 ? 3 : 4 + precision;
+  for (size_t i = 0; i < distances.size(); i++) {
+    std::fprintf(fp, "%0*.*f,%f\n", width, precision, static_cast<double>(i) * degreeStep, distances[i]);
+  }
+}
+
+
+/*!
+ * @brief Write the distances with the angles which are not equally spaced in
+ *        csv-format
+ *
+ * The angles are formatted as writeProfileCsv(), where degreeStep is the
+ * finest step of the angles.
+ * @param [in] fp          File pointer of output
+ * @param [in] angles      The angles in degree
+ * @param [in] distances   The distances for each angle
+ * @param [in] degreeStep  The finest angular step in degree
+ */
+ATTR_NOTHROW inline static void
+writeAngleProfileCsv(std::FILE *fp, const std::vector<double> &angles, const std::vector<double> &distances, double degreeStep) noexcept
+{
+  int precision = countAngleDecimals(degreeStep);
+  int width = precision == 0 ? 3 : 4 + precision;
+  for (size_t i = 0; i < distances.size(); i++) {
+    std::fprintf(fp, "%0*.*f,%f\n", width, precision, angles[i], distances[i]);
+  }
+}
+
+
+/*!
+ * @brief Count the decimal places which are needed to format the multiples of
+ *        the angular step
+ * @param [in] degreeStep  Angular step in degree
+ * @return  The number of decimal places (up to 6)
+ */
+ATTR_NOTHROW inline static int
+countAngleDecimals(double degreeStep) noexcept
+{
+  static const int MAX_PRECISION = 6;
+
+  int precision = 0;
+  for (double step = degreeStep; precision < MAX_PRECISION && std::fabs(step - std::floor(step + 0.5)) > 1.0e-9; step *= 10.0) {
+    precision++;
+  }
+  return precision;
+}
+
+
+/*!
+ * @brief Get the current position of the file in 64-bit
+ * @param [in] fp  File pointer
+ * @return  The current position
+ */
+ATTR_NOTHROW inline static unsigned long long
+tellProfileFile(std::FILE *fp) noexcept
+{
+#ifdef _WIN32
+  return static_cast<unsigned long long>(_ftelli64(fp));
+#else
+  return static_cast<unsigned long long>(ftello(fp));
+#endif
+}
+
+
+/*!
+ * @brief Round up the size to a multiple of 8 bytes
+ * @param [in] size  Size in bytes
+ * @return  Aligned size
+ */
+ATTR_NOTHROW inline static size_t
+alignProfileSize(size_t size) noexcept
+{
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+
+/*!
+ * @brief Store 32-bit value in little-endian
+ * @param [out] buf    Destination
+ * @param [in]  value  A value
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+putLe32(unsigned char *buf, unsigned long value) noexcept
+{
+  for (int i = 0; i < 4; i++) {
+    buf[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+
+/*!
+ * @brief Store 64-bit value in little-endian
+ * @param [out] buf    Destination
+ * @param [in]  value  A value
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+putLe64(unsigned char *buf, unsigned long long value) noexcept
+{
+  for (int i = 0; i < 8; i++) {
+    buf[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+
+/*!
+ * @brief Store IEEE 754 double in little-endian
+ * @param [out] buf    Destination
+ * @param [in]  value  A value
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+putLeDouble(unsigned char *buf, double value) noexcept
+{
+  unsigned long long bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  putLe64(buf, bits);
+}
+
+
+/*!
+ * @brief Store IEEE 754 float in little-endian
+ * @param [out] buf    Destination
+ * @param [in]  value  A value
+ */
+ATTR_NOTHROW ALWAYSINLINE static void
+putLeFloat(unsigned char *buf, float value) noexcept
+{
+  unsigned int bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  putLe32(buf, bits);
+}
+
+
+/*!
+ * @brief Load 32-bit value in little-endian
+ * @param [in] buf  Source
+ * @return  The value
+ */
+ATTR_NOTHROW ALWAYSINLINE static unsigned long
+getLe32(const unsigned char *buf) noexcept
+{
+  unsigned long value = 0;
+  for (int i = 3; i >= 0; i--) {
+    value = (value << 8) | buf[i];
+  }
+  return value;
+}
+
+
+/*!
+ * @brief Load 64-bit value in little-endian
+ * @param [in] buf  Source
+ * @return  The value
+ */
+ATTR_NOTHROW ALWAYSINLINE static unsigned long long
+getLe64(const unsigned char *buf) noexcept
+{
+  unsigned long long value = 0;
+  for (int i = 7; i >= 0; i--) {
+    value = (value << 8) | buf[i];
+  }
+  return value;
+}
+
+
+/*!
+ * @brief Load IEEE 754 double in little-endian
+ * @param [in] buf  Source
+ * @return  The value
+ */
+ATTR_NOTHROW ALWAYSINLINE static double
+getLeDouble(const unsigned char *buf) noexcept
+{
+  unsigned long long bits = getLe64(buf);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+
+/*!
+ * @brief Load IEEE 754 float in little-endian
+ * @param [in] buf  Source
+ * @return  The value
+ */
+ATTR_NOTHROW ALWAYSINLINE static float
+getLeFloat(const unsigned char *buf) noexcept
+{
+  unsigned int bits = static_cast<unsigned int>(getLe32(buf));
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+
+
+
+#endif  // PROFILE_UTIL_H
@@ -0,0 +1,405 @@
+/*!
+ * @brief Provide run-length representation of the region in image
+ *
+ * For each row, the region is stored as the sorted runs [begin, end) of
+ * the pixels of the foreground color.
+ *
+ * @author koturn 0;
+ * @file spanUtil.h
+ */
+#ifndef SPAN_UTIL_H
+#define SPAN_UTIL_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <opencv/cv.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+#include "../../include/commonUtil/compat.h"
+#include "colorUtil.h"
+
+
+//! A run of the foreground pixels in a row
+typedef struct {
+  int begin;  //!< The first x-position of the run
+  int end;    //!< The next x-position of the last pixel of the run
+} Span;
+
+//! Run-length representation of the region
+struct SpanIndex {
+  int               width;       //!< Width of the image
+  int               height;      //!< Height of the image
+  std::vector<int>  rowOffsets;  //!< Index of the first span of each row (height + 1 elements)
+  std::vector<Span> spans;       //!< Spans of all rows which are sorted by row and x-position
+
+  SpanIndex() :
+    width(0),
+    height(0),
+    rowOffsets(),
+    spans()
+  {}
+};
+
+
+ATTR_NOTHROW inline static void
+buildSpanIndex(SpanIndex &index, const cv::Mat &image, const ColorMatcher &matcher) noexcept;
+
+ATTR_NOTHROW inline static void
+spanIndexToMask(const SpanIndex &index, cv::Mat &mask) noexcept;
+
+inline static void
+transposeSpanIndex(const SpanIndex &index, SpanIndex &transposed);
+
+inline static void
+appendSpanDifference(const SpanIndex &index, int y, int otherY, int eventY, std::vector<std::pair<int, int> > &events);
+
+ATTR_NOTHROW inline static const Span *
+findSpan(const SpanIndex &index, int x, int y) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static bool
+isSpanLess(int x, const Span &span) noexcept;
+
+inline static int
+labelSpans(const SpanIndex &index, std::vector<int> &labels);
+
+inline static void
+extractComponents(const SpanIndex &index, const std::vector<int> &labels, const std::vector<int> &componentIds, int nComponents, std::vector<SpanIndex> &components);
+
+ATTR_NOTHROW inline static void
+uniteAdjacentRows(const SpanIndex &index, std::vector<int> &parents, int y) noexcept;
+
+ATTR_NOTHROW ALWAYSINLINE static int
+findRootSpan(std::vector<int> &parents, int k) noexcept;
+
+
+
+
+/*!
+ * @brief Build run-length representation of the region in image
+ *
+ * Rows are scanned in parallel twice: first to count the spans of each row,
+ * second to store them.
+ * @param [out] index    Run-length representation of the region
+ * @param [in]  image    A filled image
+ * @param [in]  matcher  Classifier of the color of filled region
+ */
+ATTR_NOTHROW inline static void
+buildSpanIndex(SpanIndex &index, const cv::Mat &image, const ColorMatcher &matcher) noexcept
+{
+  index.width  = image.cols;
+  index.height = image.rows;
+  index.rowOffsets.assign(static_cast<size_t>(image.rows) + 1, 0);
+
+  #pragma omp parallel for
+  for (int y = 0; y < image.rows; y++) {
+    const unsigned char *row = &image.data[y * image.step];
+    int  nSpans = 0;
+    bool isPrevForeground = false;
+    for (int x = 0; x < image.cols; x++) {
+      bool isForeground = isForegroundPixel(matcher, &row[x * image.elemSize()]);
+      if (isForeground && !isPrevForeground) nSpans++;
+      isPrevForeground = isForeground;
+    }
+    index.rowOffsets[static_cast<size_t>(y) + 1] = nSpans;
+  }
+  for (int y = 0; y < image.rows; y++) {
+    index.rowOffsets[static_cast<size_t>(y) + 1] += index.rowOffsets[static_cast<size_t>(y)];
+  }
+
+  index.spans.resize(static_cast<size_t>(index.rowOffsets.back()));
+  #pragma omp parallel for
+  for (int y = 0; y < image.rows; y++) {
+    const unsigned char *row = &image.data[y * image.step];
+    Span *span = index.spans.empty() ? nullptr : &index.spans[static_cast<size_t>(index.rowOffsets[static_cast<size_t>(y)])];
+    for (int x = 0; x < image.cols; x++) {
+      if (!isForegroundPixel(matcher, &row[x * image.elemSize()])) continue;
+      span->begin = x;
+      for (x++; x < image.cols && isForegroundPixel(matcher, &row[x * image.elemSize()]); x++);
+      span->end = x;
+      span++;
+    }
+  }
+}
+
+
+/*!
+ * @brief Draw the region into a binary mask
+ * @param [in]  index  Run-length representation of the region
+ * @param [out] mask   Binary image (CV_8UC1) whose pixels in the region are 255
+ */
+ATTR_NOTHROW inline static void
+spanIndexToMask(const SpanIndex &index, cv::Mat &mask) noexcept
+{
+  mask = cv::Mat::zeros(index.height, index.width, CV_8UC1);
+  #pragma omp parallel for
+  for (int y = 0; y < index.height; y++) {
+    unsigned char *row = mask.ptr<unsigned char>(y);
+    for (int k = index.rowOffsets[static_cast<size_t>(y)]; k < index.rowOffsets[static_cast<size_t>(y) + 1]; k++) {
+      const Span &span = index.spans[static_cast<size_t>(k)];
+      std::fill(row + span.begin, row + span.end, static_cast<unsigned char>(255));
+    }
+  }
+}
+
+
+/*!
+ * @brief Build run-length representation of the columns of the region
+ *
+ * The transposed representation has the runs of each column as its rows, so
+ * that findSpan(transposed, y, x) finds the run of the column x which
+ * contains y.  A run of a column begins at the pixels which are in the row
+ * and not in the previous row, and ends at the pixels which are in the row
+ * and not in the next row.  They are found by the difference of the spans of
+ * the adjacent rows, so that the cost is proportional to the number of the
+ * spans and the runs, not to the area.
+ * @param [in]  index       Run-length representation of the region
+ * @param [out] transposed  Run-length representation of the columns
+ */
+inline static void
+transposeSpanIndex(const SpanIndex &index, SpanIndex &transposed)
+{
+  std::vector<std::pair<int, int> > begins;
+  std::vector<std::pair<int, int> > ends;
+  for (int y = 0; y < index.height; y++) {
+    appendSpanDifference(index, y, y - 1, y, begins);
+    appendSpanDifference(index, y, y + 1, y + 1, ends);
+  }
+
+  transposed.width  = index.height;
+  transposed.height = index.width;
+  transposed.rowOffsets.assign(static_cast<size_t>(index.width) + 1, 0);
+  for (size_t i = 0; i < begins.size(); i++) {
+    transposed.rowOffsets[static_cast<size_t>(begins[i].first) + 1]++;
+  }
+  for (int x = 0; x < index.width; x++) {
+    transposed.rowOffsets[static_cast<size_t>(x) + 1] += transposed.rowOffsets[static_cast<size_t>(x)];
+  }
+  // The events are in order of y, and the k-th begin of a column pairs with its k-th end
+  transposed.spans.resize(begins.size());
+  std::vector<int> beginCursors(transposed.rowOffsets.begin(), transposed.rowOffsets.end() - 1);
+  std::vector<int> endCursors(beginCursors);
+  for (size_t i = 0; i < begins.size(); i++) {
+    transposed.spans[static_cast<size_t>(beginCursors[static_cast<size_t>(begins[i].first)]++)].begin = begins[i].second;
+    transposed.spans[static_cast<size_t>(endCursors[static_cast<size_t>(ends[i].first)]++)].end = ends[i].second;
+  }
+}
+
+
+/*!
+ * @brief Append the pixels which are in the row and not in the other row
+ * @param [in]     index   Run-length representation of the region
+ * @param [in]     y       Y-position of the row
+ * @param [in]     otherY  Y-position of the other row, which is empty if it
+ *                         is out of the image
+ * @param [in]     eventY  Y-position to append with the x-position
+ * @param [in,out] events  Pairs of the x-position and eventY
+ */
+inline static void
+appendSpanDifference(const SpanIndex &index, int y, int otherY, int eventY, std::vector<std::pair<int, int> > &events)
+{
+  const Span *spans = index.spans.empty() ? nullptr : &index.spans[0];
+  const Span *other    = spans;
+  const Span *otherEnd = spans;
+  if (0 <= otherY && otherY < index.height) {
+    other    = spans + index.rowOffsets[static_cast<size_t>(otherY)];
+    otherEnd = spans + index.rowOffsets[static_cast<size_t>(otherY) + 1];
+  }
+  for (int k = index.rowOffsets[static_cast<size_t>(y)]; k < index.rowOffsets[static_cast<size_t>(y) + 1]; k++) {
+    const Span &span = index.spans[static_cast<size_t>(k)];
+    int x = span.begin;
+    while (x < span.end) {
+      while (other != otherEnd && other->end <= x) {
+        other++;
+      }
+      if (other != otherEnd && other->begin <= x) {
+        x = other->end;
+        continue;
+      }
+      int next = other != otherEnd ? std::min(span.end, other->begin) : span.end;
+      for (; x < next; x++) {
+        events.push_back(std::make_pair(x, eventY));
+      }
+    }
+  }
+}
+
+
+/*!
+ * @brief Find the span which contains the specified position
+ * @param [in] index  Run-length representation of the region
+ * @param [in] x      X-position
+ * @param [in] y      Y-position
+ * @return  The span which contains (x, y).  nullptr if (x, y) isn't in the
+ *          region.
+ */
+ATTR_NOTHROW inline static const Span *
+findSpan(const SpanIndex &index, int x, int y) noexcept
+{
+  if (y < 0 || index.height <= y || index.spans.empty()) {
+    return nullptr;
+  }
+  const Span *first = &index.spans[0] + index.rowOffsets[static_cast<size_t>(y)];
+  const Span *last  = &index.spans[0] + index.rowOffsets[static_cast<size_t>(y) + 1];
+  const Span *span  = std::upper_bound(first, last, x, isSpanLess);
+  if (span == first || (span - 1)->end <= x) {
+    return nullptr;
+  }
+  return span - 1;
+}
+
+
+/*!
+ * @brief Compare x-position with the beginning of the span
+ * @param [in] x     X-position
+ * @param [in] span  A span
+ * @return  true if x is less than the beginning of the span
+ */
+ATTR_NOTHROW ALWAYSINLINE static bool
+isSpanLess(int x, const Span &span) noexcept
+{
+  return x < span.begin;
+}
+
+
+/*!
+ * @brief Label the connected components (8-connectivity) of the region
+ *
+ * The spans are the nodes of union-find.  The rows are divided into blocks,
+ * one for each thread, and the spans in adjacent rows are united within each
+ * block in parallel.  Since the blocks have disjoint sets of spans, no lock
+ * is needed.  Then the spans across the boundaries of the blocks are united.
+ * The root of each set is always the span which comes first in raster order,
+ * so that the labels are numbered in raster order of the components.
+ * @param [in]  index   Run-length representation of the region
+ * @param [out] labels  Label of each span
+ * @return  The number of the components
+ */
+inline static int
+labelSpans(const SpanIndex &index, std::vector<int> &labels)
+{
+  int nSpans = static_cast<int>(index.spans.size());
+  std::vector<int> parents(static_cast<size_t>(nSpans));
+  for (int k = 0; k < nSpans; k++) {
+    parents[static_cast<size_t>(k)] = k;
+  }
+#ifdef _OPENMP
+  int nBlocks = std::max(1, std::min(omp_get_max_threads(), index.height));
+#else
+  int nBlocks = 1;
+#endif
+  #pragma omp parallel for
+  for (int b = 0; b < nBlocks; b++) {
+    int y0 = static_cast<int>(static_cast<long long>(index.height) * b / nBlocks);
+    int y1 = static_cast<int>(static_cast<long long>(index.height) * (b + 1) / nBlocks);
+    for (int y = y0 + 1; y < y1; y++) {
+      uniteAdjacentRows(index, parents, y);
+    }
+  }
+  for (int b = 1; b < nBlocks; b++) {
+    uniteAdjacentRows(index, parents, static_cast<int>(static_cast<long long>(index.height) * b / nBlocks));
+  }
+
+  labels.resize(static_cast<size_t>(nSpans));
+  int nLabels = 0;
+  for (int k = 0; k < nSpans; k++) {
+    int root = findRootSpan(parents, k);
+    labels[static_cast<size_t>(k)] = root == k ? nLabels++ : labels[static_cast<size_t>(root)];
+  }
+  return nLabels;
+}
+
+
+/*!
+ * @brief Split the region into the run-length representations of the
+ *        components
+ * @param [in]  index         Run-length representation of the region
+ * @param [in]  labels        Label of each span, which labelSpans() gives
+ * @param [in]  componentIds  Index of the output component of each label
+ *                            (-1 means the component is dropped)
+ * @param [in]  nComponents   The number of the output components
+ * @param [out] components    Run-length representations of the components,
+ *                            which have the same size as the region
+ */
+inline static void
+extractComponents(const SpanIndex &index, const std::vector<int> &labels, const std::vector<int> &componentIds, int nComponents, std::vector<SpanIndex> &components)
+{
+  components.assign(static_cast<size_t>(nComponents), SpanIndex());
+  for (std::vector<SpanIndex>::iterator component = components.begin(); component != components.end(); ++component) {
+    component->width  = index.width;
+    component->height = index.height;
+    component->rowOffsets.assign(static_cast<size_t>(index.height) + 1, 0);
+  }
+  for (int y = 0; y < index.height; y++) {
+    for (int k = index.rowOffsets[static_cast<size_t>(y)]; k < index.rowOffsets[static_cast<size_t>(y) + 1]; k++) {
+      int id = componentIds[static_cast<size_t>(labels[static_cast<size_t>(k)])];
+      if (id == -1) continue;
+      SpanIndex &component = components[static_cast<size_t>(id)];
+      component.spans.push_back(index.spans[static_cast<size_t>(k)]);
+      component.rowOffsets[static_cast<size_t>(y) + 1]++;
+    }
+  }
+  for (std::vector<SpanIndex>::iterator component = components.begin(); component != components.end(); ++component) {
+    for (int y = 0; y < index.height; y++) {
+      component->rowOffsets[static_cast<size_t>(y) + 1] += component->rowOffsets[static_cast<size_t>(y)];
+    }
+  }
+}
+
+
+/*!
+ * @brief Unite the spans in the row y - 1 and the row y which are adjacent
+ *        with 8-connectivity
+ * @param [in]     index    Run-length representation of the region
+ * @param [in,out] parents  Parent of each span of union-find
+ * @param [in]     y        Y-position of the lower row
+ */
+ATTR_NOTHROW inline static void
+uniteAdjacentRows(const SpanIndex &index, std::vector<int> &parents, int y) noexcept
+{
+  int i    = index.rowOffsets[static_cast<size_t>(y) - 1];
+  int iEnd = index.rowOffsets[static_cast<size_t>(y)];
+  int j    = iEnd;
+  int jEnd = index.rowOffsets[static_cast<size_t>(y) + 1];
+  while (i < iEnd && j < jEnd) {
+    const Span &upper = index.spans[static_cast<size_t>(i)];
+    const Span &lower = index.spans[static_cast<size_t>(j)];
+    if (upper.begin <= lower.end && lower.begin <= upper.end) {
+      int a = findRootSpan(parents, i);
+      int b = findRootSpan(parents, j);
+      if (a < b) {
+        parents[static_cast<size_t>(b)] = a;
+      } else if (b < a) {
+        parents[static_cast<size_t>(a)] = b;
+      }
+    }
+    if (upper.end < lower.end) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+}
+
+
+/*!
+ * @brief Find the root of the set of union-find with path halving
+ * @param [in,out] parents  Parent of each span of union-find
+ * @param [in]     k        Index of the span
+ * @return  Index of the root span
+ */
+ATTR_NOTHROW ALWAYSINLINE static int
+findRootSpan(std::vector<int> &parents, int k) noexcept
+{
+  while (parents[static_cast<size_t>(k)] != k) {
+    parents[static_cast<size_t>(k)] = parents[static_cast<size_t>(parents[static_cast<size_t>(k)])];
+    k = parents[static_cast<size_t>(k)];
+  }
+  return k;
+}
+
+
+
+
+#endif  // SPAN_UTIL_H
@@ -0,0 +1,58 @@
+/*!
+ * @brief Provide a utility function to measure the wall-clock time
+ *
+ * omp_get_wtime() is used with OpenMP, and otherwise QueryPerformanceCounter()
+ * is used on Windows and gettimeofday() on the others, since std::clock()
+ * measures the CPU time on some platforms.
+ *
+ * @author koturn 0;
+ * @file timeUtil.h
+ */
+#ifndef TIME_UTIL_H
+#define TIME_UTIL_H
+
+#ifdef _OPENMP
+#  include <omp.h>
+#elif defined(_WIN32)
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+#include "../../include/commonUtil/compat.h"
+
+
+ATTR_NOTHROW ALWAYSINLINE static double
+getSeconds() noexcept;
+
+
+
+
+/*!
+ * @brief Get the wall-clock time
+ * @return  The time in seconds from an arbitrary point
+ */
+ATTR_NOTHROW ALWAYSINLINE static double
+getSeconds() noexcept
+{
+#ifdef _OPENMP
+  return omp_get_wtime();
+#elif defined(_WIN32)
+  LARGE_INTEGER count;
+  LARGE_INTEGER frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return static_cast<double>(count.QuadPart) / static_cast<double>(frequency.QuadPart);
+#else
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) * 1.0e-6;
+#endif
+}
+
+
+
+
+#endif  // TIME_UTIL_H